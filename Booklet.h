@@ -0,0 +1,146 @@
+// ~~ BOOKLET ~~
+
+// ----------------------------------------------------------------------------
+//
+// This file contains the booklet class, a sink for multi-page PDF output.
+// Plots are drawn into the booklet one page at a time, every page is
+// written to the file as soon as it is drawn, so that campaigns of
+// thousands of plots end up in one document without keeping more than
+// one canvas in memory.
+//
+// ----------------------------------------------------------------------------
+
+#define BOOKLET_H
+
+// ----------------------------------------------------------------------------
+//                                BOOKLET CLASS
+// ----------------------------------------------------------------------------
+
+//! Class for a multi-page PDF (or PostScript) document that is written page by page
+
+class Booklet
+{
+
+public:
+
+  Booklet(TString name, Bool_t contents = kFALSE);
+  Booklet(const Booklet&) = delete;
+  Booklet& operator=(const Booklet&) = delete;
+  ~Booklet() { Close(); }
+
+  void AddPage(TCanvas* canvas, TString title = "");
+  void Close();
+
+  void SetContents(Bool_t toc = kTRUE) {contents = toc;} //!< Toggle wether a table of contents is appended when closing
+
+  TString GetFileName() const {return fileName;} //!< Name of the output file
+  Int_t   GetNpages() const {return nPages;}     //!< Number of plot pages written so far
+
+private:
+
+  void WriteContents(TCanvas* page);
+
+  TString fileName;                  //!< Name of the output file
+  Bool_t  contents {kFALSE};         //!< Should a table of contents be appended?
+  Bool_t  closed {kFALSE};           //!< Was the file already closed?
+  Int_t   nPages {0};                //!< Number of plot pages written so far
+
+  std::vector<std::string> titles;   //!< Titles of all pages, used for the table of contents
+
+  static const Int_t linesPerPage;   //!< Number of entries per page of the table of contents
+
+};
+
+const Int_t Booklet::linesPerPage = 40;
+
+// ---- Constructor -----------------------------------------------------------
+
+//! Constructor
+Booklet::Booklet(TString name, Bool_t toc):
+  fileName(name),
+  contents(toc)
+{
+
+  if (!fileName.EndsWith(".pdf") && !fileName.EndsWith(".ps")){
+    std::cout << "\033[1;31mERROR:\033[0m Booklet " << fileName
+              << " needs to be a .pdf or .ps file! Nothing will be written." << std::endl;
+    closed = kTRUE;
+  }
+
+}
+
+// ---- Member Functions ------------------------------------------------------
+
+void Booklet::AddPage(TCanvas* canvas, TString title){
+
+  /** Writes \p canvas as the next page of the booklet. The file is opened
+      with the first page, \p title is used as the PDF bookmark of the page
+      and as its entry in the table of contents. **/
+
+  if (closed){
+    std::cout << "\033[1;31mERROR:\033[0m Booklet " << fileName << " is already closed! Page "
+              << title << " will be skipped." << std::endl;
+    return;
+  }
+
+  if (!canvas) return;
+
+  if (title.IsNull()) title = Form("Page %d", nPages + 1);
+
+  if (!nPages) canvas->Print(fileName + "[");
+  canvas->Print(fileName, "Title:" + title);
+
+  titles.push_back(title.Data());
+  nPages++;
+
+}
+
+void Booklet::Close(){
+
+  /** Appends the table of contents, if requested, and closes the file.
+      Called automatically when the booklet goes out of scope. **/
+
+  if (closed) return;
+  closed = kTRUE;
+
+  if (!nPages) return;
+
+  TCanvas page("booklet", "BOOKLET", 10, 10, 1000, 1000);
+  if (contents) WriteContents(&page);
+  page.Print(fileName + "]");
+
+  std::cout << "Info: Booklet " << fileName << " has been written with " << nPages << " pages" << std::endl;
+
+}
+
+void Booklet::WriteContents(TCanvas* page){
+
+  /** Appends the table of contents listing the title and page number of
+      every plot. It is written behind the plots, since the pages before
+      already left memory when the booklet is closed. **/
+
+  for (Int_t first = 0; first < nPages; first += linesPerPage){
+
+    page->Clear();
+    page->cd();
+
+    TPaveText* text = new TPaveText(0.05, 0.05, 0.95, 0.95, "NDC");
+    text->SetFillStyle(0);
+    text->SetBorderSize(0);
+    text->SetTextAlign(12);
+    text->SetTextFont(83);
+    text->SetTextSize(18);
+
+    text->AddText(first ? "Contents (continued)" : "Contents");
+    for (Int_t entry = first; entry < std::min(first + linesPerPage, nPages); entry++)
+      text->AddText(Form("%5d   %s", entry + 1, titles[entry].data()));
+
+    text->Draw();
+    page->Print(fileName, "Title:Contents");
+
+    page->Clear();
+    delete text;
+
+  }
+
+}
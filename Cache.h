@@ -0,0 +1,331 @@
+// ~~ CACHE ~~
+
+// ----------------------------------------------------------------------------
+//
+// This file contains the cache for derived objects, e.g. ratios to a
+// reference, normalized spectra or projections of a TH2, that are used by
+// many plots of a campaign. Every derived object is computed once and
+// handed out again as long as its inputs did not change. Objects are
+// identified by the operation, its parameters and the identity of the
+// inputs; the inputs are fingerprinted (cf. HashObject) to notice when they
+// are refilled. Once the cache holds more than its memory cap, the objects
+// used least recently are dropped. Objects still needed by plots that are
+// drawn later can be pinned, dropped objects are then only deleted once
+// they are released.
+//
+// ----------------------------------------------------------------------------
+
+#define CACHE_H
+
+// ----------------------------------------------------------------------------
+//                             DERIVED CACHE CLASS
+// ----------------------------------------------------------------------------
+
+//! Class for sharing derived objects between plots, with LRU eviction
+
+class DerivedCache
+{
+
+public:
+
+  DerivedCache(Long64_t maxBytes = 256 << 20, Bool_t contents = kFALSE);
+  DerivedCache(const DerivedCache&) = delete;
+  DerivedCache& operator=(const DerivedCache&) = delete;
+  ~DerivedCache();
+
+  TObject* Get(const std::string& operation, const std::vector<TObject*>& inputs, const std::function<TObject*()>& build);
+
+  TH1* Ratio(TH1* numerator, TH1* denominator, TString option = "");
+  TH1* Normalized(TH1* hist, Double_t norm = 1., TString option = "");
+  TH1D* ProjectionX(TH2* map, Int_t firstBin = 0, Int_t lastBin = -1);
+  TH1D* ProjectionY(TH2* map, Int_t firstBin = 0, Int_t lastBin = -1);
+
+  void Pin(TObject* obj);
+  void Pin(TObjArray* array);
+  void Release(TObject* obj);
+  void Release(TObjArray* array);
+
+  void Clear();
+  void SetMaxBytes(Long64_t maxBytes);
+
+  Long64_t GetBytes() const {return bytes;}        //!< Estimated memory held by the cached objects
+  Int_t GetNobjects() const {return entries.size();} //!< Number of cached objects
+  Int_t GetNretired() const {return retired.size();} //!< Number of dropped objects kept alive by pins
+  Long64_t GetNhits() const {return nHits;}        //!< Number of requests answered from the cache
+  Long64_t GetNmisses() const {return nMisses;}    //!< Number of requests that built the object
+
+  static Long64_t GetBytes(TObject* obj);
+
+private:
+
+  //! Derived object and the state of its inputs when it was built
+  struct Entry {
+    TObject* obj {nullptr};                        //!< Derived object, owned by the cache
+    ULong64_t fingerprint {0};                     //!< Fingerprint of the inputs
+    Long64_t bytes {0};                            //!< Estimated memory of the object
+    std::list<std::string>::iterator use;          //!< Position in the order of use
+  };
+
+  ULong64_t Fingerprint(const std::vector<TObject*>& inputs) const;
+  void Remove(std::unordered_map<std::string, Entry>::iterator entry);
+  void Evict();
+
+  std::unordered_map<std::string, Entry> entries;  //!< Cached objects by key
+  std::list<std::string> uses;                     //!< Keys of the cached objects, most recently used first
+  std::unordered_map<TObject*, Int_t> pins;        //!< Number of pins of every pinned object
+  std::set<TObject*> retired;                      //!< Objects dropped from the cache while pinned, deleted once released
+
+  Long64_t limit;                                  //!< Memory cap in bytes
+  Long64_t bytes {0};                              //!< Estimated memory held by the cached objects
+  Bool_t   checksum;                               //!< Are the contents of the inputs fingerprinted, or only their entries?
+  Long64_t nHits {0};                              //!< Number of requests answered from the cache
+  Long64_t nMisses {0};                            //!< Number of requests that built the object
+
+};
+
+// ---- Constructor -----------------------------------------------------------
+
+//! Constructor
+DerivedCache::DerivedCache(Long64_t maxBytes, Bool_t contents):
+  limit(maxBytes),
+  checksum(contents)
+{
+
+  /** Holds at most about \p maxBytes of derived objects. Changes of the inputs
+      are detected from their number of entries (histograms) and points
+      (graphs), or from all of their bins and points with \p contents. The
+      latter also notices inputs changed via SetBinContent, but costs about
+      as much as many of the derived operations themselves. **/
+
+}
+
+//! Destructor
+DerivedCache::~DerivedCache(){
+
+  /** Deletes all cached objects, including pinned ones **/
+
+  Clear();
+  for (TObject* obj : retired) delete obj;
+
+}
+
+// ---- Member Functions ------------------------------------------------------
+
+TObject* DerivedCache::Get(const std::string& operation, const std::vector<TObject*>& inputs, const std::function<TObject*()>& build){
+
+  /** Returns the object derived by \p operation (which has to include all of
+      its parameters) from \p inputs. It is only built by calling \p build if
+      it is not cached yet or if any input changed since it was built. The
+      object belongs to the cache and stays valid until it is rebuilt or
+      evicted, unless it is pinned (cf. Pin). **/
+
+  std::string key = operation;
+  for (TObject* input : inputs) key += Form(":%p", (void*)input);
+
+  ULong64_t fingerprint = Fingerprint(inputs);
+
+  auto cached = entries.find(key);
+  if (cached != entries.end()){
+    if (cached->second.fingerprint == fingerprint){
+      uses.splice(uses.begin(), uses, cached->second.use);
+      nHits++;
+      return cached->second.obj;
+    }
+    Remove(cached);  // an input was refilled
+  }
+
+  nMisses++;
+
+  TObject* obj = build();
+  if (!obj) return nullptr;
+  if (obj->InheritsFrom("TH1")) ((TH1*)obj)->SetDirectory(nullptr);
+
+  uses.push_front(key);
+
+  Entry& entry = entries[key];
+  entry.obj = obj;
+  entry.fingerprint = fingerprint;
+  entry.bytes = GetBytes(obj);
+  entry.use = uses.begin();
+
+  bytes += entry.bytes;
+  Evict();
+
+  return obj;
+
+}
+
+TH1* DerivedCache::Ratio(TH1* numerator, TH1* denominator, TString option){
+
+  /** Returns \p numerator divided by \p denominator (cf. TH1::Divide, "B" for
+      binomial errors) **/
+
+  return (TH1*)Get(Form("ratio:%s", option.Data()), {numerator, denominator}, [&](){
+    TH1* ratio = (TH1*)numerator->Clone(Form("%s_over_%s", numerator->GetName(), denominator->GetName()));
+    ratio->SetDirectory(nullptr);
+    ratio->Divide(numerator, denominator, 1., 1., option);
+    return (TObject*)ratio;
+  });
+
+}
+
+TH1* DerivedCache::Normalized(TH1* hist, Double_t norm, TString option){
+
+  /** Returns \p hist scaled to an integral of \p norm, \p option is passed to
+      TH1::Integral (e.g. "width") **/
+
+  return (TH1*)Get(Form("norm:%.17g:%s", norm, option.Data()), {hist}, [&](){
+    TH1* normalized = (TH1*)hist->Clone(Form("%s_norm", hist->GetName()));
+    normalized->SetDirectory(nullptr);
+    Double_t integral = hist->Integral(option);
+    if (integral != 0) normalized->Scale(norm/integral);
+    return (TObject*)normalized;
+  });
+
+}
+
+TH1D* DerivedCache::ProjectionX(TH2* map, Int_t firstBin, Int_t lastBin){
+
+  /** Returns the projection of \p map onto the X-axis between the Y-bins
+      \p firstBin and \p lastBin (cf. TH2::ProjectionX) **/
+
+  return (TH1D*)Get(Form("px:%d:%d", firstBin, lastBin), {map}, [&](){
+    TH1D* projection = map->ProjectionX(Form("%s_px_%d_%d", map->GetName(), firstBin, lastBin), firstBin, lastBin, "e");
+    projection->SetDirectory(nullptr);
+    return (TObject*)projection;
+  });
+
+}
+
+TH1D* DerivedCache::ProjectionY(TH2* map, Int_t firstBin, Int_t lastBin){
+
+  /** Returns the projection of \p map onto the Y-axis between the X-bins
+      \p firstBin and \p lastBin (cf. TH2::ProjectionY) **/
+
+  return (TH1D*)Get(Form("py:%d:%d", firstBin, lastBin), {map}, [&](){
+    TH1D* projection = map->ProjectionY(Form("%s_py_%d_%d", map->GetName(), firstBin, lastBin), firstBin, lastBin, "e");
+    projection->SetDirectory(nullptr);
+    return (TObject*)projection;
+  });
+
+}
+
+void DerivedCache::Pin(TObject* obj){
+
+  /** Keeps \p obj alive until it is released, even if it is evicted or
+      rebuilt in the meantime, e.g. while a plot using it is not drawn yet.
+      Pins are counted, every Pin needs one Release. **/
+
+  if (obj) pins[obj]++;
+
+}
+
+void DerivedCache::Pin(TObjArray* array){
+
+  /** Pins all objects in \p array, e.g. the array of a plot drawn later **/
+
+  TIter next(array);
+  while (TObject* obj = next()) Pin(obj);
+
+}
+
+void DerivedCache::Release(TObject* obj){
+
+  /** Removes one pin of \p obj. Once it has no pins left and was dropped
+      from the cache in the meantime, it is deleted. **/
+
+  auto pinned = pins.find(obj);
+  if (pinned == pins.end()) return;
+  if (--pinned->second > 0) return;
+
+  pins.erase(pinned);
+  if (retired.erase(obj)) delete obj;
+
+}
+
+void DerivedCache::Release(TObjArray* array){
+
+  /** Releases all objects in \p array, which must not be used afterwards
+      (the array does not own them) **/
+
+  TIter next(array);
+  while (TObject* obj = next()) Release(obj);
+
+}
+
+void DerivedCache::Clear(){
+
+  /** Drops all cached objects, they are deleted unless they are pinned **/
+
+  for (auto& entry : entries){
+    if (pins.count(entry.second.obj)) retired.insert(entry.second.obj);
+    else delete entry.second.obj;
+  }
+  entries.clear();
+  uses.clear();
+  bytes = 0;
+
+}
+
+void DerivedCache::SetMaxBytes(Long64_t maxBytes){
+
+  /** Sets the memory cap, evicting objects right away if needed **/
+
+  limit = maxBytes;
+  Evict();
+
+}
+
+ULong64_t DerivedCache::Fingerprint(const std::vector<TObject*>& inputs) const {
+
+  /** Summarizes the state of all \p inputs **/
+
+  ULong64_t hash = 14695981039346656037ULL;
+  for (TObject* input : inputs) hash = HashObject(input, checksum, hash);
+  return hash;
+
+}
+
+void DerivedCache::Remove(std::unordered_map<std::string, Entry>::iterator entry){
+
+  /** Drops a cached object, it is deleted unless it is pinned **/
+
+  bytes -= entry->second.bytes;
+  if (pins.count(entry->second.obj)) retired.insert(entry->second.obj);
+  else delete entry->second.obj;
+  uses.erase(entry->second.use);
+  entries.erase(entry);
+
+}
+
+void DerivedCache::Evict(){
+
+  /** Drops the objects used least recently until the cache fits its memory
+      cap. The most recent object is always kept. **/
+
+  while (bytes > limit && uses.size() > 1) Remove(entries.find(uses.back()));
+
+}
+
+Long64_t DerivedCache::GetBytes(TObject* obj){
+
+  /** Estimates the memory held by \p obj from its bins or points **/
+
+  Long64_t size = 1024;  // object itself, axes and attributes
+
+  if (obj->InheritsFrom("TH1")){
+    TH1* hist = (TH1*)obj;
+    size += (Long64_t)hist->GetNcells()*sizeof(Double_t);
+    size += (Long64_t)hist->GetSumw2N()*sizeof(Double_t);
+  }
+  else if (obj->InheritsFrom("TGraph")){
+    TGraph* graph = (TGraph*)obj;
+    Int_t nColumns = 2;
+    for (const Double_t* column : {graph->GetEX(), graph->GetEY(), graph->GetEXlow(), graph->GetEXhigh(), graph->GetEYlow(), graph->GetEYhigh()})
+      nColumns += (column != nullptr);
+    size += (Long64_t)graph->GetN()*nColumns*sizeof(Double_t);
+  }
+
+  return size;
+
+}
@@ -0,0 +1,288 @@
+// ~~ CHANNEL ~~
+
+// ----------------------------------------------------------------------------
+//
+// This file contains the shared channel class, handing histograms (or any
+// other objects) from analysis processes to the plotter through POSIX
+// shared memory instead of files on disk.
+// The producer serializes its objects into a TMemFile image that is copied
+// into one of two slots of the shared segment, consumers copy the image
+// out of the slot, check that the producer did not overwrite it meanwhile,
+// and read the objects they want to plot from their copy.
+// A publication becomes visible to the consumers as soon as Publish returns.
+// Each channel is meant for a single producer and any number of consumers.
+//
+// ----------------------------------------------------------------------------
+
+#define CHANNEL_H
+
+// ----------------------------------------------------------------------------
+//                             SHARED CHANNEL CLASS
+// ----------------------------------------------------------------------------
+
+//! Class for publishing and reading objects through a shared memory segment
+
+class SharedChannel
+{
+
+public:
+
+  SharedChannel(std::string name, Bool_t create = kFALSE, Long64_t capacity = 64 << 20);
+  SharedChannel(const SharedChannel&) = delete;
+  SharedChannel& operator=(const SharedChannel&) = delete;
+  ~SharedChannel();
+
+  Bool_t IsValid() const {return header != nullptr;}  //!< Is the shared segment mapped?
+
+  Bool_t Publish(TObjArray* array);
+  TObjArray* Fetch(std::vector<std::string> names = {});
+  Bool_t HasUpdate() const;
+  Bool_t WaitForUpdate(Int_t timeout = -1);
+  ULong64_t GetSequence() const;
+
+private:
+
+  //! Layout of the beginning of the shared segment, followed by the two slots
+  struct Header {
+    UInt_t   magic;                         //!< Marks an initialised channel
+    UInt_t   version;                       //!< Layout version
+    Long64_t capacity;                      //!< Size of each slot
+    std::atomic<ULong64_t> started;         //!< Number of the last publication that was started
+    std::atomic<ULong64_t> sequence;        //!< Number of the last publication that was completed
+    Long64_t sizes[2];                      //!< Size of the image in each slot
+  };
+
+  char* Slot(ULong64_t publication) const;
+
+  std::string name;                         //!< Name of the shared memory segment
+  Bool_t  owner {kFALSE};                   //!< Was the segment created by this object?
+  Header* header {nullptr};                 //!< Mapped segment
+  size_t  length {0};                       //!< Length of the mapped segment
+  ULong64_t fetched {0};                    //!< Publication read by the last Fetch
+  std::vector<char> image;                  //!< Private copy of the last fetched image
+
+  static const UInt_t magicNumber;          //!< Value of Header::magic
+  static const Int_t  maxRetries;           //!< Number of attempts of Fetch while the producer is overtaking
+
+};
+
+const UInt_t SharedChannel::magicNumber = 0x506c4368;
+const Int_t  SharedChannel::maxRetries  = 10;
+
+// ---- Constructor -----------------------------------------------------------
+
+//! Constructor
+SharedChannel::SharedChannel(std::string segment, Bool_t create, Long64_t capacity):
+  name(segment),
+  owner(create)
+{
+
+  /** Opens the shared memory segment \p segment (e.g. "/plotti_run"). The
+      producer creates it with \p create, reserving \p capacity bytes for
+      each of the two slots; consumers only attach to an existing segment. **/
+
+  if (name.empty() || name[0] != '/') name = "/" + name;
+
+  Int_t fd = shm_open(name.data(), create ? (O_CREAT | O_RDWR) : O_RDWR, 0600);
+  if (fd < 0){
+    std::cout << "\033[1;31mERROR:\033[0m Shared channel " << name << " could not be opened: "
+              << std::strerror(errno) << std::endl;
+    return;
+  }
+
+  if (create){
+    length = sizeof(Header) + 2*capacity;
+    if (ftruncate(fd, length) != 0){
+      std::cout << "\033[1;31mERROR:\033[0m Shared channel " << name << " could not be resized: "
+                << std::strerror(errno) << std::endl;
+      close(fd);
+      return;
+    }
+  }
+  else {
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(Header)){
+      std::cout << "\033[1;31mERROR:\033[0m Shared channel " << name << " is not initialised!" << std::endl;
+      close(fd);
+      return;
+    }
+    length = info.st_size;
+  }
+
+  void* memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (memory == MAP_FAILED){
+    std::cout << "\033[1;31mERROR:\033[0m Shared channel " << name << " could not be mapped: "
+              << std::strerror(errno) << std::endl;
+    return;
+  }
+
+  header = (Header*)memory;
+
+  if (create){
+    header->magic    = magicNumber;
+    header->version  = 1;
+    header->capacity = capacity;
+    new (&header->started)  std::atomic<ULong64_t>(0);
+    new (&header->sequence) std::atomic<ULong64_t>(0);
+    header->sizes[0] = header->sizes[1] = 0;
+  }
+  else if (header->magic != magicNumber || (size_t)(sizeof(Header) + 2*header->capacity) > length){
+    std::cout << "\033[1;31mERROR:\033[0m " << name << " is not a shared channel!" << std::endl;
+    munmap(memory, length);
+    header = nullptr;
+  }
+
+}
+
+//! Destructor
+SharedChannel::~SharedChannel(){
+
+  /** The producer removes the segment, consumers that are still attached
+      keep their mapping until they are destroyed themselves **/
+
+  if (header) munmap(header, length);
+  if (owner) shm_unlink(name.data());
+
+}
+
+// ---- Member Functions ------------------------------------------------------
+
+char* SharedChannel::Slot(ULong64_t publication) const {
+
+  /** Returns the slot holding \p publication, publications alternate between the two slots **/
+
+  return (char*)header + sizeof(Header) + (publication % 2)*header->capacity;
+
+}
+
+Bool_t SharedChannel::Publish(TObjArray* array){
+
+  /** Serializes all objects in \p array into the slot that is currently not
+      read and makes them visible to the consumers. Objects are stored under
+      their names. **/
+
+  if (!header || !array) return kFALSE;
+
+  TMemFile image("channel", "RECREATE");
+  for (Int_t index = 0; index < array->GetEntriesFast(); index++){
+    TObject* obj = array->UncheckedAt(index);
+    if (obj) image.WriteTObject(obj, obj->GetName());
+  }
+  image.Write();
+
+  Long64_t size = image.GetSize();
+  if (size > header->capacity){
+    std::cout << "\033[1;31mERROR:\033[0m Objects need " << size << " bytes, but shared channel " << name
+              << " only holds " << header->capacity << " bytes! Nothing will be published." << std::endl;
+    return kFALSE;
+  }
+
+  ULong64_t publication = header->sequence.load(std::memory_order_relaxed) + 1;
+
+  header->started.store(publication, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  image.CopyTo(Slot(publication), size);
+  header->sizes[publication % 2] = size;
+
+  header->sequence.store(publication, std::memory_order_release);
+
+  return kTRUE;
+
+}
+
+TObjArray* SharedChannel::Fetch(std::vector<std::string> names){
+
+  /** Reads the objects \p names (all objects if empty) of the latest
+      publication. The image is copied out of shared memory first and only
+      opened once the copy is known to be complete, so a producer overtaking
+      the consumer never hands a torn image to ROOT. If the producer started
+      to overwrite the slot during the copy, copying is repeated. The returned
+      array owns the objects. **/
+
+  if (!header) return nullptr;
+
+  Bool_t status = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(kFALSE);
+
+  TObjArray* array = nullptr;
+
+  for (Int_t attempt = 0; attempt < maxRetries && !array; attempt++){
+
+    ULong64_t publication = header->sequence.load(std::memory_order_acquire);
+    if (!publication) break;
+
+    // the slot of a publication is reused by the publication two after it
+    Long64_t size = header->sizes[publication % 2];
+    if (size <= 0 || size > header->capacity) continue;
+    image.resize(size);
+    std::memcpy(image.data(), Slot(publication), size);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header->started.load(std::memory_order_relaxed) > publication + 1) continue;
+
+    array = new TObjArray();
+    array->SetOwner(kTRUE);
+
+    TMemFile file("channel", TMemFile::ZeroCopyView_t(image.data(), size));
+
+    if (names.empty()){
+      TIter next(file.GetListOfKeys());
+      while (TKey* key = (TKey*)next()) array->Add(key->ReadObj());
+    }
+    else {
+      for (const std::string& obj : names) array->Add(file.Get(obj.data()));
+    }
+
+    fetched = publication;
+
+  }
+
+  TH1::AddDirectory(status);
+
+  if (array){
+    for (Int_t index = 0; index < array->GetEntriesFast(); index++){
+      TObject* obj = array->UncheckedAt(index);
+      if (obj && obj->InheritsFrom("TH1")) ((TH1*)obj)->SetDirectory(nullptr);
+      else if (!obj && index < (Int_t)names.size())
+        std::cout << "\033[1;31mERROR:\033[0m Object " << names[index] << " not found in shared channel " << name << std::endl;
+    }
+  }
+
+  return array;
+
+}
+
+Bool_t SharedChannel::HasUpdate() const {
+
+  /** Returns wether the producer published since the last Fetch **/
+
+  return header && header->sequence.load(std::memory_order_acquire) > fetched;
+
+}
+
+Bool_t SharedChannel::WaitForUpdate(Int_t timeout){
+
+  /** Waits up to \p timeout milliseconds (forever if negative) for a new publication **/
+
+  auto start = std::chrono::steady_clock::now();
+
+  while (!HasUpdate()){
+    if (!header) return kFALSE;
+    if (timeout >= 0 && std::chrono::steady_clock::now() - start > std::chrono::milliseconds(timeout)) return kFALSE;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  return kTRUE;
+
+}
+
+ULong64_t SharedChannel::GetSequence() const {
+
+  /** Returns the number of the latest publication (0 if nothing was published yet) **/
+
+  return header ? header->sequence.load(std::memory_order_acquire) : 0;
+
+}
@@ -0,0 +1,407 @@
+// ~~ DAEMON ~~
+
+// ----------------------------------------------------------------------------
+//
+// This file contains the plot daemon, a long-lived process that keeps ROOT
+// and PlottI loaded and renders plot jobs received over a local Unix
+// domain socket. Every job is one line of semicolon separated key=value
+// pairs, e.g.
+//
+//   class=square;file=in.root;keys=h1,h2;xtitle=p_{T};ytitle=counts;out=pt.png
+//
+// The inputs and the output of a job are given by
+//  - file:    input ROOT file, keys: comma separated names of the objects
+//             (shm:/name reads from the SharedChannel /name instead)
+//  - ratiofile, ratios: input file (default: file) and names of the ratios
+//  - out:     output file (required)
+// all other keys describe the plot as in a render spec (cf. Spec.h). Each
+// spec is compiled into a RenderPlan once and reused by all later jobs.
+// The daemon replies with one line per job, "OK ..." or "ERROR ...",
+// including the time spent loading the objects and the total time.
+// Additionally "ping" and "quit" are understood.
+//
+// ----------------------------------------------------------------------------
+
+#define DAEMON_H
+
+// ----------------------------------------------------------------------------
+//                               PLOT DAEMON CLASS
+// ----------------------------------------------------------------------------
+
+//! Class for a resident plotting process accepting jobs over a Unix domain socket
+
+class PlotDaemon
+{
+
+public:
+
+  PlotDaemon(std::string socketPath = "/tmp/plottid.sock");
+  PlotDaemon(const PlotDaemon&) = delete;
+  PlotDaemon& operator=(const PlotDaemon&) = delete;
+  ~PlotDaemon();
+
+  Bool_t Run();
+  std::string Process(std::string line);
+
+  Int_t GetNjobs() const {return nJobs;} //!< Number of jobs processed so far
+
+private:
+
+  typedef std::map<std::string, std::string> Job;
+
+  static Job ParseJob(const std::string& line);
+
+  TFile* OpenFile(const std::string& name);
+  TObjArray* LoadArray(const std::string& file, const std::string& keys, std::string& error);
+  TObjArray* FetchArray(const std::string& channel, const std::string& keys, std::string& error);
+  std::string Render(Job& job, Double_t& loadTime);
+  void Serve(Int_t connection);
+
+  std::string path;                 //!< Path of the socket
+  Int_t  listener {-1};             //!< File descriptor of the listening socket
+  Bool_t running {kFALSE};          //!< Is the daemon accepting jobs?
+  Int_t  nJobs {0};                 //!< Number of jobs processed so far
+
+  std::map<std::string, std::pair<TFile*, time_t>> files;  //!< Open input files and their modification times
+  std::map<std::string, SharedChannel*> channels;           //!< Attached shared channels
+  std::map<std::string, std::shared_ptr<const RenderPlan>> plans;  //!< Compiled specs of previous jobs
+
+  static const UInt_t maxPlans;     //!< Number of compiled specs kept
+
+};
+
+const UInt_t PlotDaemon::maxPlans = 256;
+
+// ---- Constructor -----------------------------------------------------------
+
+//! Constructor
+PlotDaemon::PlotDaemon(std::string socketPath):
+  path(socketPath)
+{
+
+  /** Everything that would otherwise be paid by every job is done once here **/
+
+  gROOT->SetBatch(kTRUE);
+  TH1::AddDirectory(kFALSE);
+  if (!TTF::IsInitialized()) TTF::Init();
+  Plot::SetCanvasPool(kTRUE);
+
+}
+
+//! Destructor
+PlotDaemon::~PlotDaemon(){
+
+  for (auto& file : files) delete file.second.first;
+  for (auto& channel : channels) delete channel.second;
+  if (listener >= 0){
+    close(listener);
+    unlink(path.data());
+  }
+
+}
+
+// ---- Member Functions ------------------------------------------------------
+
+Bool_t PlotDaemon::Run(){
+
+  /** Listens on the socket and processes jobs until "quit" is received.
+      Connections are served one after the other, since painting with ROOT
+      is not thread safe. **/
+
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+
+  if (path.size() >= sizeof(address.sun_path)){
+    std::cout << "\033[1;31mERROR:\033[0m Socket path " << path << " is too long!" << std::endl;
+    return kFALSE;
+  }
+  std::strncpy(address.sun_path, path.data(), sizeof(address.sun_path) - 1);
+
+  listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0){
+    std::cout << "\033[1;31mERROR:\033[0m Socket could not be created: " << std::strerror(errno) << std::endl;
+    return kFALSE;
+  }
+
+  unlink(path.data());
+  if (bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 16) < 0){
+    std::cout << "\033[1;31mERROR:\033[0m Could not listen on " << path << ": " << std::strerror(errno) << std::endl;
+    close(listener);
+    listener = -1;
+    return kFALSE;
+  }
+
+  std::cout << "Info: plottid listening on " << path << std::endl;
+
+  running = kTRUE;
+  while (running){
+
+    Int_t connection = accept(listener, nullptr, nullptr);
+    if (connection < 0){
+      if (errno == EINTR) continue;
+      std::cout << "\033[1;31mERROR:\033[0m Connection could not be accepted: " << std::strerror(errno) << std::endl;
+      break;
+    }
+
+    Serve(connection);
+    close(connection);
+
+  }
+
+  close(listener);
+  unlink(path.data());
+  listener = -1;
+
+  std::cout << "Info: plottid stopped after " << nJobs << " jobs" << std::endl;
+  return kTRUE;
+
+}
+
+void PlotDaemon::Serve(Int_t connection){
+
+  /** Reads jobs line by line from \p connection and replies to each of them **/
+
+  std::string buffer;
+  char chunk[4096];
+
+  while (running){
+
+    ssize_t nRead = read(connection, chunk, sizeof(chunk));
+    if (nRead < 0 && errno == EINTR) continue;
+    if (nRead <= 0) return;
+
+    buffer.append(chunk, nRead);
+
+    size_t end;
+    while (running && (end = buffer.find('\n')) != std::string::npos){
+
+      std::string reply = Process(buffer.substr(0, end));
+      buffer.erase(0, end + 1);
+
+      for (size_t written = 0; written < reply.size(); ){
+        ssize_t nWritten = write(connection, reply.data() + written, reply.size() - written);
+        if (nWritten < 0 && errno == EINTR) continue;
+        if (nWritten <= 0) return;
+        written += nWritten;
+      }
+
+    }
+
+  }
+
+}
+
+std::string PlotDaemon::Process(std::string line){
+
+  /** Processes a single job and returns the reply, terminated by a newline.
+      Can also be used directly, without going through the socket. **/
+
+  line.erase(line.find_last_not_of(" \t\r") + 1);
+  line.erase(0, line.find_first_not_of(" \t"));
+
+  if (line.empty()) return "";
+  if (line == "ping") return "OK pong\n";
+  if (line == "quit"){
+    running = kFALSE;
+    return "OK bye\n";
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  Job job = ParseJob(line);
+  Double_t loadTime = 0;
+  std::string error = Render(job, loadTime);
+
+  Double_t totalTime = std::chrono::duration<Double_t, std::milli>(std::chrono::steady_clock::now() - start).count();
+  nJobs++;
+
+  std::ostringstream reply;
+  reply.setf(std::ios::fixed);
+  reply.precision(1);
+
+  if (error.empty()) reply << "OK job=" << nJobs << " load=" << loadTime << "ms total=" << totalTime << "ms out=" << job["out"];
+  else reply << "ERROR job=" << nJobs << " total=" << totalTime << "ms " << error;
+  reply << "\n";
+
+  return reply.str();
+
+}
+
+PlotDaemon::Job PlotDaemon::ParseJob(const std::string& line){
+
+  /** Splits a job line into its key=value pairs, like the statements of a spec **/
+
+  Job job;
+
+  for (const std::string& field : RenderPlan::SplitStatements(line)){
+    size_t equal = field.find('=');
+    if (equal == std::string::npos) job[field] = "";
+    else job[field.substr(0, equal)] = field.substr(equal + 1);
+  }
+
+  return job;
+
+}
+
+TFile* PlotDaemon::OpenFile(const std::string& name){
+
+  /** Returns the input file \p name, files stay open between jobs and are
+      only reopened if they were modified in the meantime **/
+
+  struct stat info;
+  if (stat(name.data(), &info) != 0) return nullptr;
+
+  auto cached = files.find(name);
+  if (cached != files.end()){
+    if (cached->second.second == info.st_mtime) return cached->second.first;
+    delete cached->second.first;
+    files.erase(cached);
+  }
+
+  TFile* file = TFile::Open(name.data(), "READ");
+  if (!file || file->IsZombie()){
+    delete file;
+    return nullptr;
+  }
+
+  files[name] = std::make_pair(file, info.st_mtime);
+  return file;
+
+}
+
+TObjArray* PlotDaemon::LoadArray(const std::string& file, const std::string& keys, std::string& error){
+
+  /** Reads all objects in the comma separated list \p keys from \p file,
+      or from the shared channel if \p file is given as shm:/name. Histograms
+      are not added to the file (cf. constructor), so every object read is a
+      new copy that belongs to the returned array. **/
+
+  if (file.compare(0, 4, "shm:") == 0) return FetchArray(file.substr(4), keys, error);
+
+  TFile* input = OpenFile(file);
+  if (!input){
+    error = "input file " + file + " could not be opened";
+    return nullptr;
+  }
+
+  std::vector<std::string> names = RenderPlan::Split(keys, ',');
+  if (names.empty()){
+    error = "no objects given";
+    return nullptr;
+  }
+
+  TObjArray* array = new TObjArray(names.size());
+  array->SetOwner(kTRUE);
+
+  for (const std::string& name : names){
+
+    TObject* obj = input->Get(name.data());
+    if (!obj){
+      error = "object " + name + " not found in " + file;
+      delete array;
+      return nullptr;
+    }
+
+    if (obj->InheritsFrom("TH1")) ((TH1*)obj)->SetDirectory(nullptr);
+    array->Add(obj);
+
+  }
+
+  return array;
+
+}
+
+TObjArray* PlotDaemon::FetchArray(const std::string& channel, const std::string& keys, std::string& error){
+
+  /** Reads the objects in the comma separated list \p keys from the latest
+      publication of the shared channel \p channel, channels stay attached between jobs **/
+
+  SharedChannel*& shared = channels[channel];
+  if (!shared) shared = new SharedChannel(channel);
+
+  if (!shared->IsValid()){
+    error = "shared channel " + channel + " could not be opened";
+    delete shared;
+    channels.erase(channel);
+    return nullptr;
+  }
+
+  std::vector<std::string> names = RenderPlan::Split(keys, ',');
+  TObjArray* array = shared->Fetch(names);
+
+  if (!array){
+    error = "nothing published in shared channel " + channel;
+    return nullptr;
+  }
+
+  for (Int_t index = 0; index < array->GetEntriesFast(); index++){
+    if (array->UncheckedAt(index)) continue;
+    error = "object " + names[index] + " not found in " + channel;
+    delete array;
+    return nullptr;
+  }
+
+  if (!array->GetEntries()){
+    error = "no objects given";
+    delete array;
+    return nullptr;
+  }
+
+  return array;
+
+}
+
+std::string PlotDaemon::Render(Job& job, Double_t& loadTime){
+
+  /** Draws the plot described by \p job, returns an error message if anything
+      went wrong. All keys except the inputs and output form the spec of the
+      plot, which is only compiled the first time it is seen. **/
+
+  if (job["out"].empty()) return "no output file given (out=...)";
+  if (job["file"].empty()) return "no input file given (file=...)";
+
+  std::string spec;
+  for (auto& field : job){
+    if (field.first == "file" || field.first == "keys" || field.first == "ratiofile"
+        || field.first == "ratios" || field.first == "out") continue;
+    spec += field.first + "=" + field.second + "\n";
+  }
+
+  std::string error;
+  std::shared_ptr<const RenderPlan> plan = plans[spec];
+  if (!plan){
+    plan = RenderPlan::Compile(spec, error);
+    if (!plan){
+      plans.erase(spec);
+      return "invalid spec: " + error;
+    }
+    if (plans.size() > maxPlans) plans.clear();
+    plans[spec] = plan;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  TObjArray* main = LoadArray(job["file"], job["keys"], error);
+  if (!main) return error;
+
+  TObjArray* ratios = nullptr;
+  if (!job["ratios"].empty()){
+    ratios = LoadArray(job["ratiofile"].empty() ? job["file"] : job["ratiofile"], job["ratios"], error);
+    if (!ratios){
+      delete main;
+      return error;
+    }
+  }
+
+  loadTime = std::chrono::duration<Double_t, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  if (plan->Check(main, ratios, error) && !plan->Draw(main, job["out"], ratios))
+    error = "plot could not be set up, see log of plottid";
+
+  delete main;
+  delete ratios;
+
+  return error;
+
+}
@@ -0,0 +1,336 @@
+// ~~ INGEST ~~
+
+// ----------------------------------------------------------------------------
+//
+// This file contains the ingest class, filling histograms from large flat
+// inputs that are not ROOT files: text tables (CSV or whitespace separated)
+// and binary dumps of records of floats or doubles.
+// The input is memory-mapped instead of read line by line. It is split into
+// one part per thread, each thread parses its rows in chunks into column
+// buffers and fills them into its own copies of the histograms with FillN.
+// The copies are added to the histograms at the end, so filling scales with
+// the number of cores until it is limited by the disk.
+//
+// ----------------------------------------------------------------------------
+
+#define INGEST_H
+
+// ----------------------------------------------------------------------------
+//                                 INGEST CLASS
+// ----------------------------------------------------------------------------
+
+//! Class for filling histograms in parallel from memory-mapped text or binary files
+
+class Ingest
+{
+
+public:
+
+  enum Format : unsigned int {
+    CSV,                                    //!< Text, one row per line
+    Float,                                  //!< Binary records of Float_t
+    Double                                  //!< Binary records of Double_t
+  };
+
+  Ingest(TString path, Format format = CSV, Int_t nColumns = 0);
+  Ingest(const Ingest&) = delete;
+  Ingest& operator=(const Ingest&) = delete;
+  ~Ingest();
+
+  Bool_t IsValid() const {return data != nullptr;}              //!< Is the input mapped?
+
+  void SetDelimiter(char delim) {delimiter = delim;}            //!< Set the column delimiter of text input (default ',')
+  void SetHeaderLines(Int_t lines) {headerLines = lines;}       //!< Set the number of lines skipped at the beginning of text input
+
+  void Add(TH1* hist, Int_t xColumn, Int_t yColumn = -1, Int_t weightColumn = -1);
+  Long64_t Fill(Int_t nThreads = 0);
+
+private:
+
+  //! Histogram and the buffer slots of its columns
+  struct Target {
+    TH1*  hist;                             //!< Filled histogram
+    Int_t x;                                //!< Slot of the X values
+    Int_t y;                                //!< Slot of the Y values, -1 for one-dimensional histograms
+    Int_t weight;                           //!< Slot of the weights, -1 for unit weights
+  };
+
+  Int_t Slot(Int_t column);
+  Bool_t ParseLine(const char* begin, const char* end, std::vector<Double_t>& row) const;
+  Long64_t FillPart(Long64_t begin, Long64_t end, const std::vector<TH1*>& hists, Long64_t& bad) const;
+
+  TString path;                             //!< Path of the input
+  Format  format;                           //!< Format of the input
+  Int_t   nColumns;                         //!< Number of columns per binary record
+  char*   data {nullptr};                   //!< Mapped input
+  Long64_t length {0};                      //!< Length of the input in bytes
+
+  char  delimiter {','};                    //!< Column delimiter of text input
+  Int_t headerLines {0};                    //!< Number of lines skipped at the beginning of text input
+
+  std::vector<Target> targets;              //!< Histograms to be filled
+  std::vector<Int_t> columns;               //!< Column of every buffer slot
+
+  static constexpr Int_t chunkRows {4096};  //!< Number of rows parsed before they are filled
+
+};
+
+// ---- Constructor -----------------------------------------------------------
+
+//! Constructor
+Ingest::Ingest(TString input, Format fmt, Int_t columnsPerRecord):
+  path(input),
+  format(fmt),
+  nColumns(columnsPerRecord)
+{
+
+  /** Maps the file \p input. Binary records consist of \p columnsPerRecord
+      values, text input is split into columns by the delimiter. **/
+
+  if (format != CSV && nColumns <= 0){
+    std::cout << "\033[1;31mERROR:\033[0m Number of columns of binary input " << path << " is missing!" << std::endl;
+    return;
+  }
+
+  Int_t fd = open(path.Data(), O_RDONLY);
+  if (fd < 0){
+    std::cout << "\033[1;31mERROR:\033[0m " << path << " could not be opened: " << std::strerror(errno) << std::endl;
+    return;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0){
+    std::cout << "\033[1;31mERROR:\033[0m " << path << " is empty!" << std::endl;
+    close(fd);
+    return;
+  }
+  length = info.st_size;
+
+  void* memory = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (memory == MAP_FAILED){
+    std::cout << "\033[1;31mERROR:\033[0m " << path << " could not be mapped: " << std::strerror(errno) << std::endl;
+    return;
+  }
+
+  madvise(memory, length, MADV_SEQUENTIAL);
+  data = (char*)memory;
+
+}
+
+//! Destructor
+Ingest::~Ingest(){
+
+  if (data) munmap(data, length);
+
+}
+
+// ---- Member Functions ------------------------------------------------------
+
+void Ingest::Add(TH1* hist, Int_t xColumn, Int_t yColumn, Int_t weightColumn){
+
+  /** Fills \p hist with the values of column \p xColumn (and \p yColumn for a
+      TH2), weighted by \p weightColumn if given. Columns count from zero. **/
+
+  if (!hist || (yColumn >= 0 && !hist->InheritsFrom("TH2"))){
+    std::cout << "\033[1;31mERROR:\033[0m Histogram for columns " << xColumn << ", " << yColumn
+              << " is missing or not two-dimensional! Will be skipped." << std::endl;
+    return;
+  }
+
+  if (xColumn < 0 || (format != CSV && std::max({xColumn, yColumn, weightColumn}) >= nColumns)){
+    std::cout << "\033[1;31mERROR:\033[0m Columns of " << hist->GetName() << " do not exist in " << path
+              << "! Will be skipped." << std::endl;
+    return;
+  }
+
+  targets.push_back({hist, Slot(xColumn), (yColumn < 0) ? -1 : Slot(yColumn), (weightColumn < 0) ? -1 : Slot(weightColumn)});
+
+}
+
+Long64_t Ingest::Fill(Int_t nThreads){
+
+  /** Fills all added histograms from the whole input using \p nThreads threads
+      (all hardware threads if 0) and returns the number of rows. Rows of text
+      input that cannot be parsed are skipped and counted. **/
+
+  if (!IsValid()){
+    std::cout << "\033[1;31mERROR:\033[0m Input " << path << " is not mapped, nothing will be filled." << std::endl;
+    return 0;
+  }
+  if (targets.empty()) return 0;
+
+  Long64_t start = 0;
+  for (Int_t line = 0; format == CSV && line < headerLines && start < length; line++){
+    const char* lineEnd = (const char*)std::memchr(data + start, '\n', length - start);
+    start = lineEnd ? lineEnd - data + 1 : length;
+  }
+
+  if (nThreads <= 0) nThreads = std::max(1u, std::thread::hardware_concurrency());
+  nThreads = std::max(1LL, std::min((Long64_t)nThreads, (length - start)/(1 << 20) + 1));  // at least 1 MB per thread
+
+  // parts start at the beginning of a line or record
+  Long64_t record = nColumns*((format == Float) ? sizeof(Float_t) : sizeof(Double_t));
+  std::vector<Long64_t> bounds(nThreads + 1, length);
+  bounds[0] = start;
+  for (Int_t part = 1; part < nThreads; part++){
+    Long64_t split = start + (length - start)*part/nThreads;
+    if (format == CSV){
+      const char* lineEnd = (const char*)std::memchr(data + split, '\n', length - split);
+      bounds[part] = lineEnd ? lineEnd - data + 1 : length;
+    }
+    else bounds[part] = start + (split - start)/record*record;
+    bounds[part] = std::max(bounds[part], bounds[part - 1]);
+  }
+
+  // the first part fills the histograms themselves, all others fill copies
+  std::vector<std::vector<TH1*>> hists(nThreads);
+  for (Int_t part = 0; part < nThreads; part++){
+    for (const Target& target : targets){
+      TH1* hist = target.hist;
+      if (part){
+        hist = (TH1*)target.hist->Clone(Form("%s_ingest%d", target.hist->GetName(), part));
+        hist->SetDirectory(nullptr);
+        hist->Reset();
+      }
+      hists[part].push_back(hist);
+    }
+  }
+
+  std::vector<Long64_t> rows(nThreads, 0), bad(nThreads, 0);
+  ParallelFor(nThreads, [&](Int_t part){
+    rows[part] = FillPart(bounds[part], bounds[part + 1], hists[part], bad[part]);
+  }, nThreads);
+
+  for (Int_t part = 1; part < nThreads; part++){
+    for (UInt_t target = 0; target < targets.size(); target++){
+      targets[target].hist->Add(hists[part][target]);
+      delete hists[part][target];
+    }
+  }
+
+  Long64_t nRows = std::accumulate(rows.begin(), rows.end(), 0LL);
+  Long64_t nBad  = std::accumulate(bad.begin(), bad.end(), 0LL);
+  if (nBad) std::cout << "\033[1;31mERROR:\033[0m " << nBad << " rows of " << path << " could not be parsed and were skipped." << std::endl;
+
+  return nRows;
+
+}
+
+Int_t Ingest::Slot(Int_t column){
+
+  /** Returns the buffer slot of \p column, adding one if needed **/
+
+  auto existing = std::find(columns.begin(), columns.end(), column);
+  if (existing != columns.end()) return existing - columns.begin();
+
+  columns.push_back(column);
+  return columns.size() - 1;
+
+}
+
+Bool_t Ingest::ParseLine(const char* begin, const char* end, std::vector<Double_t>& row) const {
+
+  /** Parses the first row.size() columns of the line [\p begin, \p end).
+      Blanks before a field are skipped. If the delimiter is a blank itself,
+      any run of blanks separates two fields, as in aligned tables. **/
+
+  const char* position = begin;
+  Bool_t blankDelimiter = delimiter == ' ' || delimiter == '\t';
+
+  for (UInt_t column = 0; column < row.size(); column++){
+
+    while (position < end && (*position == ' ' || *position == '\t') && (blankDelimiter || *position != delimiter)) position++;
+
+    std::from_chars_result result = std::from_chars(position, end, row[column]);
+    if (result.ec != std::errc()) return kFALSE;
+    position = result.ptr;
+
+    if (column + 1 == row.size()) break;
+
+    if (blankDelimiter){
+      if (position == end || (*position != ' ' && *position != '\t')) return kFALSE;
+      continue;  // the whole run is skipped before the next field
+    }
+
+    position = (const char*)std::memchr(position, delimiter, end - position);
+    if (!position) return kFALSE;
+    position++;
+
+  }
+
+  return kTRUE;
+
+}
+
+Long64_t Ingest::FillPart(Long64_t begin, Long64_t end, const std::vector<TH1*>& hists, Long64_t& bad) const {
+
+  /** Fills \p hists (one per target) with the rows starting in [\p begin, \p end).
+      The needed columns of up to chunkRows rows are collected in buffers and
+      filled at once. **/
+
+  std::vector<std::vector<Double_t>> values(columns.size(), std::vector<Double_t>(chunkRows));
+  Int_t n = 0;
+  Long64_t rows = 0;
+
+  auto flush = [&](){
+    for (UInt_t target = 0; target < targets.size(); target++){
+      const Target& t = targets[target];
+      const Double_t* w = (t.weight < 0) ? nullptr : values[t.weight].data();
+      if (t.y < 0) hists[target]->FillN(n, values[t.x].data(), w);
+      else ((TH2*)hists[target])->FillN(n, values[t.x].data(), values[t.y].data(), w);
+    }
+    rows += n;
+    n = 0;
+  };
+
+  if (format == CSV){
+
+    std::vector<Double_t> row(*std::max_element(columns.begin(), columns.end()) + 1);
+
+    for (Long64_t position = begin; position < end;){
+
+      const char* line = data + position;
+      const char* lineEnd = (const char*)std::memchr(line, '\n', length - position);
+      if (!lineEnd) lineEnd = data + length;
+      position = lineEnd - data + 1;
+
+      if (!ParseLine(line, lineEnd, row)){
+        if (!std::all_of(line, lineEnd, [](char c){return std::isspace((unsigned char)c);})) bad++;
+        continue;
+      }
+
+      for (UInt_t slot = 0; slot < columns.size(); slot++) values[slot][n] = row[columns[slot]];
+      if (++n == chunkRows) flush();
+
+    }
+
+  }
+  else {
+
+    Int_t size = (format == Float) ? sizeof(Float_t) : sizeof(Double_t);
+    Long64_t record = nColumns*size;
+
+    for (Long64_t position = begin; position + record <= end; position += record){
+
+      for (UInt_t slot = 0; slot < columns.size(); slot++){
+        const char* value = data + position + columns[slot]*size;
+        if (format == Float){
+          Float_t single;
+          std::memcpy(&single, value, sizeof(single));
+          values[slot][n] = single;
+        }
+        else std::memcpy(&values[slot][n], value, sizeof(Double_t));
+      }
+      if (++n == chunkRows) flush();
+
+    }
+
+  }
+
+  if (n) flush();
+
+  return rows;
+
+}
@@ -0,0 +1,535 @@
+// ~~ LAYOUT ~~
+
+// ----------------------------------------------------------------------------
+//
+// This file contains helpers for the automatic layout of plots
+//  - OccupancyGrid: coarse raster of the frame of a pad, used to find
+//                   empty regions for legends
+//  - TextMetrics: cache of text extents, used to size legends, margins
+//                 and title offsets without painting
+//
+// ----------------------------------------------------------------------------
+
+#define LAYOUT_H
+
+//! Status bits of legends that are laid out automatically
+enum ELayoutBits {
+  kPositionAuto = BIT(14),   //!< Legend will be placed in the emptiest region of the pad
+  kLayoutAuto   = BIT(15)    //!< Size and number of columns of the legend will be fitted to its entries
+};
+
+// ----------------------------------------------------------------------------
+//                            OCCUPANCY GRID CLASS
+// ----------------------------------------------------------------------------
+
+//! Coarse raster of the frame of a pad counting how much is drawn in each cell
+
+class OccupancyGrid
+{
+
+public:
+
+  OccupancyGrid(Double_t x1, Double_t x2, Double_t y1, Double_t y2, Int_t nx = 64, Int_t ny = 64);
+  ~OccupancyGrid() {}
+
+  void SetRanges(Double_t xLow, Double_t xUp, Double_t yLow, Double_t yUp, Bool_t xLog = kFALSE, Bool_t yLog = kFALSE);
+  void Fill(TObject* obj);
+  void FillBox(Double_t x1, Double_t y1, Double_t x2, Double_t y2, Double_t weight = 1.);
+  Bool_t FindEmptiest(Double_t w, Double_t h, Double_t& x1, Double_t& y1);
+
+  Double_t GetFrameWidth() const {return frameX2 - frameX1;}  //!< Width of the frame (NDC)
+  Double_t GetFrameHeight() const {return frameY2 - frameY1;} //!< Height of the frame (NDC)
+
+private:
+
+  Double_t ColumnPosition(Double_t x) const;
+  Double_t RowPosition(Double_t y) const;
+  void FillSpan(Int_t col, Int_t row1, Int_t row2, Double_t weight = 1.);
+  void FillRange(Double_t xLow, Double_t xUp, Double_t yLow, Double_t yUp);
+  void FillSegment(Double_t xa, Double_t ya, Double_t xb, Double_t yb);
+  void FillHistogram(TH1* hist);
+  void FillGraph(TGraph* graph);
+  void FillFunction(TF1* func);
+  void BuildTable();
+
+  Int_t nCols;                    //!< Number of columns of the grid
+  Int_t nRows;                    //!< Number of rows of the grid
+
+  Double_t frameX1;               //!< Left edge of the frame (NDC)
+  Double_t frameX2;               //!< Right edge of the frame (NDC)
+  Double_t frameY1;               //!< Lower edge of the frame (NDC)
+  Double_t frameY2;               //!< Upper edge of the frame (NDC)
+
+  Double_t uLow {0};              //!< Lower X-range in (log) user coordinates
+  Double_t uUp {1};               //!< Upper X-range in (log) user coordinates
+  Double_t vLow {0};              //!< Lower Y-range in (log) user coordinates
+  Double_t vUp {1};               //!< Upper Y-range in (log) user coordinates
+  Bool_t   logX {kFALSE};         //!< Is X-axis logarithmic?
+  Bool_t   logY {kFALSE};         //!< Is Y-axis logarithmic?
+
+  std::vector<Double_t> spans;    //!< Per column difference array of the filled row spans
+  std::vector<Double_t> table;    //!< Summed-area table of the occupancy
+  Bool_t dirty {kTRUE};           //!< Has the grid been filled since the table was built?
+
+};
+
+// ---- Constructor -----------------------------------------------------------
+
+//! Constructor
+OccupancyGrid::OccupancyGrid(Double_t x1, Double_t x2, Double_t y1, Double_t y2, Int_t nx, Int_t ny):
+  nCols(nx),
+  nRows(ny),
+  frameX1(x1),
+  frameX2(x2),
+  frameY1(y1),
+  frameY2(y2),
+  spans(nx*(ny+1), 0.),
+  table((nx+1)*(ny+1), 0.)
+{
+
+  /** Generate grid with \p nx x \p ny cells covering the frame from (\p x1, \p y1)
+      to (\p x2, \p y2) in relative (NDC) coordinates of the pad **/
+
+}
+
+// ---- Member Functions ------------------------------------------------------
+
+void OccupancyGrid::SetRanges(Double_t xLow, Double_t xUp, Double_t yLow, Double_t yUp, Bool_t xLog, Bool_t yLog){
+
+  /** Set the axis ranges of the frame in user coordinates **/
+
+  logX = xLog && xLow > 0;
+  logY = yLog && yLow > 0;
+
+  uLow = logX ? TMath::Log10(xLow) : xLow;
+  uUp  = logX ? TMath::Log10(xUp)  : xUp;
+  vLow = logY ? TMath::Log10(yLow) : yLow;
+  vUp  = logY ? TMath::Log10(yUp)  : yUp;
+
+}
+
+Double_t OccupancyGrid::ColumnPosition(Double_t x) const {
+
+  /** Position of user coordinate \p x in units of columns, counted from the left edge of the frame **/
+
+  if (logX) x = (x > 0) ? TMath::Log10(x) : -DBL_MAX;
+  Double_t pos = (x - uLow)/(uUp - uLow)*nCols;
+
+  return std::max(std::min(pos, 1E6), -1E6);
+
+}
+
+Double_t OccupancyGrid::RowPosition(Double_t y) const {
+
+  /** Position of user coordinate \p y in units of rows, counted from the lower edge of the frame **/
+
+  if (logY) y = (y > 0) ? TMath::Log10(y) : -DBL_MAX;
+  Double_t pos = (y - vLow)/(vUp - vLow)*nRows;
+
+  return std::max(std::min(pos, 1E6), -1E6);
+
+}
+
+void OccupancyGrid::FillSpan(Int_t col, Int_t row1, Int_t row2, Double_t weight){
+
+  /** Mark rows \p row1 to \p row2 of column \p col as occupied, rows outside of
+      the frame are clipped. Only the ends of the span are stored, so that this
+      is constant in time regardless of the length of the span **/
+
+  if (col < 0 || col >= nCols) return;
+  if (row1 > row2) std::swap(row1, row2);
+  if (row2 < 0 || row1 >= nRows) return;
+
+  row1 = std::max(row1, 0);
+  row2 = std::min(row2, nRows-1);
+
+  spans[col*(nRows+1) + row1]   += weight;
+  spans[col*(nRows+1) + row2+1] -= weight;
+  dirty = kTRUE;
+
+}
+
+void OccupancyGrid::FillRange(Double_t xLow, Double_t xUp, Double_t yLow, Double_t yUp){
+
+  /** Mark rectangle given in user coordinates as occupied **/
+
+  Double_t col1 = ColumnPosition(xLow), col2 = ColumnPosition(xUp);
+  if (!(col1 <= col2)) std::swap(col1, col2);
+  if (!(col1 <= col2)) return;
+
+  Int_t row1 = (Int_t)TMath::Floor(RowPosition(yLow));
+  Int_t row2 = (Int_t)TMath::Floor(RowPosition(yUp));
+
+  for (Int_t col = std::max((Int_t)TMath::Floor(col1), 0); col <= std::min((Int_t)TMath::Floor(col2), nCols-1); col++){
+    FillSpan(col, row1, row2);
+  }
+
+}
+
+void OccupancyGrid::FillSegment(Double_t xa, Double_t ya, Double_t xb, Double_t yb){
+
+  /** Mark line from (\p xa, \p ya) to (\p xb, \p yb) in user coordinates as occupied **/
+
+  Double_t colA = ColumnPosition(xa), colB = ColumnPosition(xb);
+  Double_t rowA = RowPosition(ya),    rowB = RowPosition(yb);
+
+  if (colA > colB){
+    std::swap(colA, colB);
+    std::swap(rowA, rowB);
+  }
+  if (!(colA <= colB) || TMath::IsNaN(rowA) || TMath::IsNaN(rowB)) return;
+
+  Double_t slope = (colB > colA) ? (rowB - rowA)/(colB - colA) : 0;
+
+  for (Int_t col = std::max((Int_t)TMath::Floor(colA), 0); col <= std::min((Int_t)TMath::Floor(colB), nCols-1); col++){
+    Double_t row1 = (colB > colA) ? rowA + slope*(std::max(colA, (Double_t)col) - colA) : rowA;
+    Double_t row2 = (colB > colA) ? rowA + slope*(std::min(colB, (Double_t)col+1) - colA) : rowB;
+    FillSpan(col, (Int_t)TMath::Floor(row1), (Int_t)TMath::Floor(row2));
+  }
+
+}
+
+void OccupancyGrid::FillHistogram(TH1* hist){
+
+  /** Mark markers, error bars and connecting lines of \p hist as occupied,
+      for heatmaps all filled cells are marked **/
+
+  TAxis* xAxis = hist->GetXaxis();
+
+  if (hist->GetDimension() == 2){
+
+    TAxis* yAxis = hist->GetYaxis();
+
+    for (Int_t binx = 1; binx <= hist->GetNbinsX(); binx++){
+      for (Int_t biny = 1; biny <= hist->GetNbinsY(); biny++){
+        if (hist->GetBinContent(hist->GetBin(binx, biny)) == 0) continue;
+        FillRange(xAxis->GetBinLowEdge(binx), xAxis->GetBinUpEdge(binx), yAxis->GetBinLowEdge(biny), yAxis->GetBinUpEdge(biny));
+      }
+    }
+
+    return;
+
+  }
+
+  Double_t previous = 0;
+
+  for (Int_t bin = 1; bin <= hist->GetNbinsX(); bin++){
+
+    Double_t content = hist->GetBinContent(bin);
+    Double_t error   = hist->GetBinError(bin);
+
+    Double_t low  = std::min(content - error, (bin > 1) ? previous : content - error);
+    Double_t high = std::max(content + error, (bin > 1) ? previous : content + error);
+    previous = content;
+
+    FillRange(xAxis->GetBinLowEdge(bin), xAxis->GetBinUpEdge(bin), low, high);
+
+  }
+
+}
+
+void OccupancyGrid::FillGraph(TGraph* graph){
+
+  /** Mark points, error bars and connecting lines of \p graph as occupied **/
+
+  Double_t* x = graph->GetX();
+  Double_t* y = graph->GetY();
+
+  for (Int_t point = 0; point < graph->GetN(); point++){
+
+    FillRange(x[point] - graph->GetErrorXlow(point), x[point] + graph->GetErrorXhigh(point),
+              y[point] - graph->GetErrorYlow(point), y[point] + graph->GetErrorYhigh(point));
+
+    if (point > 0) FillSegment(x[point-1], y[point-1], x[point], y[point]);
+
+  }
+
+}
+
+void OccupancyGrid::FillFunction(TF1* func){
+
+  /** Mark curve of \p func as occupied, sampled a few times per column **/
+
+  Double_t xMin, xMax;
+  func->GetRange(xMin, xMax);
+
+  Int_t nSamples = 4*nCols;
+  Double_t step = (xMax - xMin)/nSamples;
+  Double_t previous = func->Eval(xMin);
+
+  for (Int_t sample = 1; sample <= nSamples; sample++){
+    Double_t value = func->Eval(xMin + sample*step);
+    FillSegment(xMin + (sample-1)*step, previous, xMin + sample*step, value);
+    previous = value;
+  }
+
+}
+
+void OccupancyGrid::Fill(TObject* obj){
+
+  /** Rasterize plottable object into the grid. Legends and other paves are
+      taken at their current position and weighted strongly, so that they
+      are never overlapped **/
+
+  if (!obj) return;
+
+  if (obj->InheritsFrom("TPave")){
+    TPave* pave = (TPave*)obj;
+    FillBox(pave->GetX1(), pave->GetY1(), pave->GetX2(), pave->GetY2(), 1E9);
+  }
+  else if (obj->InheritsFrom("TH1"))         FillHistogram((TH1*)obj);
+  else if (obj->InheritsFrom("TGraph"))      FillGraph((TGraph*)obj);
+  else if (obj->InheritsFrom("TF1"))         FillFunction((TF1*)obj);
+  else if (obj->InheritsFrom("TLine")){
+    TLine* line = (TLine*)obj;
+    FillSegment(line->GetX1(), line->GetY1(), line->GetX2(), line->GetY2());
+  }
+  else if (obj->InheritsFrom("TMultiGraph")){
+    TIter iMultiGraph(((TMultiGraph*)obj)->GetListOfGraphs());
+    while (TObject* graph = iMultiGraph()) Fill(graph);
+  }
+
+}
+
+void OccupancyGrid::FillBox(Double_t x1, Double_t y1, Double_t x2, Double_t y2, Double_t weight){
+
+  /** Mark box given in relative (NDC) coordinates of the pad with \p weight **/
+
+  Int_t col1 = (Int_t)TMath::Floor((x1 - frameX1)/(frameX2 - frameX1)*nCols);
+  Int_t col2 = (Int_t)TMath::Ceil((x2 - frameX1)/(frameX2 - frameX1)*nCols) - 1;
+  Int_t row1 = (Int_t)TMath::Floor((y1 - frameY1)/(frameY2 - frameY1)*nRows);
+  Int_t row2 = (Int_t)TMath::Ceil((y2 - frameY1)/(frameY2 - frameY1)*nRows) - 1;
+
+  for (Int_t col = std::max(col1, 0); col <= std::min(col2, nCols-1); col++) FillSpan(col, row1, row2, weight);
+
+}
+
+void OccupancyGrid::BuildTable(){
+
+  /** Resolve the filled spans and build the summed-area table, so that the
+      occupancy of any rectangle is given by four table lookups **/
+
+  for (Int_t col = 0; col < nCols; col++){
+
+    Double_t cell = 0;
+    Double_t column = 0;
+
+    for (Int_t row = 0; row < nRows; row++){
+      cell   += spans[col*(nRows+1) + row];
+      column += cell;
+      table[(col+1)*(nRows+1) + row+1] = table[col*(nRows+1) + row+1] + column;
+    }
+
+  }
+
+  dirty = kFALSE;
+
+}
+
+Bool_t OccupancyGrid::FindEmptiest(Double_t w, Double_t h, Double_t& x1, Double_t& y1){
+
+  /** Finds the position of the box of width \p w and height \p h (NDC) inside the
+      frame, that covers the least drawn objects. Among equally empty positions the
+      ones closest to the top and to the sides of the frame are preferred.
+      The lower left corner of the box is returned in \p x1 and \p y1 **/
+
+  if (dirty) BuildTable();
+
+  Int_t wCells = (Int_t)TMath::Ceil(w/(frameX2 - frameX1)*nCols);
+  Int_t hCells = (Int_t)TMath::Ceil(h/(frameY2 - frameY1)*nRows);
+
+  if (wCells > nCols || hCells > nRows) return kFALSE;
+
+  Double_t best = DBL_MAX;
+  Int_t bestCol = 0, bestRow = 0, bestSide = 0;
+
+  for (Int_t row = nRows - hCells; row >= 0; row--){
+    for (Int_t col = 0; col <= nCols - wCells; col++){
+
+      Double_t occupancy = table[(col+wCells)*(nRows+1) + row+hCells] - table[col*(nRows+1) + row+hCells]
+                         - table[(col+wCells)*(nRows+1) + row]        + table[col*(nRows+1) + row];
+      Int_t side = std::min(col, nCols - wCells - col);
+
+      if (occupancy < best - 1E-9 || (occupancy < best + 1E-9 && row == bestRow && side < bestSide)){
+        best     = occupancy;
+        bestCol  = col;
+        bestRow  = row;
+        bestSide = side;
+      }
+
+    }
+  }
+
+  x1 = frameX1 + (frameX2 - frameX1)*bestCol/nCols;
+  y1 = frameY1 + (frameY2 - frameY1)*bestRow/nRows;
+
+  return kTRUE;
+
+}
+
+// ----------------------------------------------------------------------------
+//                              TEXT METRICS CLASS
+// ----------------------------------------------------------------------------
+
+//! Cache of text extents, so that repeated layouts do not measure the same text twice
+
+class TextMetrics
+{
+
+public:
+
+  static void    GetTextExtent(const std::string& text, Font_t font, Float_t size, UInt_t& w, UInt_t& h);
+  static UInt_t  GetTextWidth(const std::string& text, Font_t font, Float_t size);
+  static UInt_t  GetTextHeight(const std::string& text, Font_t font, Float_t size);
+  static Float_t GetPixelSize(Font_t font, Float_t size, UInt_t padWidth, UInt_t padHeight);
+  static void    Clear() {extents.clear();} //!< Remove all cached extents
+
+private:
+
+  static std::string PlainText(const std::string& text);
+
+  static std::unordered_map<std::string, std::pair<UInt_t, UInt_t>> extents;  //!< Cached extents keyed by font, size and text
+
+};
+
+// ---- Static Member Variables -----------------------------------------------
+
+std::unordered_map<std::string, std::pair<UInt_t, UInt_t>> TextMetrics::extents;
+
+// ---- Member Functions ------------------------------------------------------
+
+void TextMetrics::GetTextExtent(const std::string& text, Font_t font, Float_t size, UInt_t& w, UInt_t& h){
+
+  /** Extent (width \p w and height \p h) in pixels of \p text written in \p font
+      with \p size in pixels. The text is measured with the TrueType engine without
+      painting it, every combination of text, font and size is measured only once.
+      LaTeX commands are approximated by single characters. **/
+
+  std::string key = std::to_string(font) + ":" + std::to_string(size) + ":" + text;
+
+  auto cached = extents.find(key);
+  if (cached != extents.end()){
+    w = cached->second.first;
+    h = cached->second.second;
+    return;
+  }
+
+  std::string plain = PlainText(text);
+  w = 0;
+  h = 0;
+
+  if (!plain.empty()){
+    if (!TTF::IsInitialized()) TTF::Init();
+    TTF::SetTextFont(font);
+    TTF::SetTextSize(size);
+    TTF::GetTextExtent(w, h, (char*)plain.data());
+  }
+
+  extents[key] = std::make_pair(w, h);
+
+}
+
+UInt_t TextMetrics::GetTextWidth(const std::string& text, Font_t font, Float_t size){
+
+  /** Width in pixels of \p text written in \p font with \p size in pixels **/
+
+  UInt_t w, h;
+  GetTextExtent(text, font, size, w, h);
+
+  return w;
+
+}
+
+UInt_t TextMetrics::GetTextHeight(const std::string& text, Font_t font, Float_t size){
+
+  /** Height in pixels of \p text written in \p font with \p size in pixels **/
+
+  UInt_t w, h;
+  GetTextExtent(text, font, size, w, h);
+
+  return h;
+
+}
+
+Float_t TextMetrics::GetPixelSize(Font_t font, Float_t size, UInt_t padWidth, UInt_t padHeight){
+
+  /** Text size in pixels, for fonts with precision 3 \p size already is in pixels,
+      otherwise it is relative to the smaller dimension of the pad **/
+
+  if (font%10 == 3) return size;
+  return size*std::min(padWidth, padHeight);
+
+}
+
+std::string TextMetrics::PlainText(const std::string& text){
+
+  /** Strip LaTeX markup from \p text, commands like \#pi are replaced by one character **/
+
+  std::string plain;
+  plain.reserve(text.size());
+
+  for (size_t pos = 0; pos < text.size(); pos++){
+
+    char c = text[pos];
+
+    if (c == '#'){
+      while (pos + 1 < text.size() && isalpha(text[pos+1])) pos++;
+      plain += 'x';
+    }
+    else if (c != '{' && c != '}' && c != '^' && c != '_') plain += c;
+
+  }
+
+  return plain;
+
+}
+
+// ----------------------------------------------------------------------------
+//                              LEGEND LAYOUT
+// ----------------------------------------------------------------------------
+
+void FitLegendLayout(TLegend* legend, UInt_t padWidth, UInt_t padHeight, Float_t maxWidth = 0.8, Float_t maxHeight = 0.4){
+
+  /** Fit size and number of columns of \p legend to its entries in a pad of
+      \p padWidth x \p padHeight pixels. Columns are added until the legend is
+      lower than \p maxHeight or wider than \p maxWidth (relative to the pad).
+      The upper left corner of the legend is kept. **/
+
+  Float_t size = TextMetrics::GetPixelSize(legend->GetTextFont(), legend->GetTextSize(), padWidth, padHeight);
+  if (size <= 0) size = 0.04*padHeight;
+
+  Int_t  nEntries = 0;
+  UInt_t widest   = 0;
+  UInt_t highest  = 0;
+
+  TIter iEntries(legend->GetListOfPrimitives());
+  while (TLegendEntry* entry = (TLegendEntry*)iEntries()){
+    UInt_t w, h;
+    TextMetrics::GetTextExtent(entry->GetLabel(), legend->GetTextFont(), size, w, h);
+    widest  = std::max(widest, w);
+    highest = std::max(highest, h);
+    nEntries++;
+  }
+
+  if (!nEntries) return;
+
+  Float_t rowHeight   = std::max(size, (Float_t)highest)*(1 + legend->GetEntrySeparation());
+  Float_t columnWidth = (widest + 0.5*size)/(1 - legend->GetMargin());
+
+  Int_t nColumns = 1;
+  while (nColumns < nEntries){
+    Int_t nRows = (nEntries + nColumns - 1)/nColumns;
+    if (nRows*rowHeight + 0.5*size <= maxHeight*padHeight) break;
+    if ((nColumns+1)*columnWidth > maxWidth*padWidth) break;
+    nColumns++;
+  }
+
+  Int_t nRows = (nEntries + nColumns - 1)/nColumns;
+
+  legend->SetNColumns(nColumns);
+  legend->SetX2(legend->GetX1() + nColumns*columnWidth/padWidth);
+  legend->SetY1(legend->GetY2() - (nRows*rowHeight + 0.5*size)/padHeight);
+
+}
+
+//
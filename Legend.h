@@ -9,6 +9,7 @@
 //  - plain text (information)
 //  - descriptions of dummy markers
 //  - other legends
+// and a builder for legends with many entries (LegendBuilder)
 //
 // ----------------------------------------------------------------------------
 
@@ -32,23 +33,29 @@ public:
   const Legend* GetLegendPointer() const {return this;}  //!< Return pointer to class object
   static void SetPosition(TLegend* l, Float_t x1, Float_t x2, Float_t y1, Float_t y2);
   void SetPosition(Float_t x1, Float_t x2, Float_t y1, Float_t y2);
+  static void SetPositionAuto(TLegend* l);
   void SetPositionAuto();
+  static void SetLayoutAuto(TLegend* l);
+  void SetLayoutAuto();
 
-  std::vector<TH1*> dummy;   //!< Vector for holding dummy markers
+  TLegendEntry* AddMarker(std::string entry, Color_t color, Style_t marker, Size_t size = 3., std::string opt = "p");
+
+private:
+
+  static std::string ReadLine(std::istringstream& stream);
+  static std::string ReadToken(std::istringstream& stream);
 
 };
 
 // ---- Constructors ----------------------------------------------------------
 
 //! Default constructor
-Legend::Legend(): TLegend(),
-  dummy(0)
+Legend::Legend(): TLegend()
 {
 }
 
 //! Generate legend from array
-Legend::Legend(TObjArray* array, std::string entr, std::string opt, std::string title, Int_t nEntries, std::string name): TLegend(0.1, 0.7, 0.3, 0.9),
-  dummy(0)
+Legend::Legend(TObjArray* array, std::string entr, std::string opt, std::string title, Int_t nEntries, std::string name): TLegend(0.1, 0.7, 0.3, 0.9)
 {
 
   if (!array) {
@@ -59,23 +66,20 @@ Legend::Legend(TObjArray* array, std::string entr, std::string opt, std::string
   std::istringstream entries(entr);
   std::istringstream options(opt);
 
-  TString* option    = new TString();
-  TString* entryName = new TString();
-
   if (title != "") AddEntry((TObject*)0x0, title.data(), "");
   if (name  != "") fName = name;
 
-  TIter iArray(array);
-  while (TObject* obj = iArray()) {
+  for (Int_t index = 0; index < array->GetEntriesFast(); index++) {
 
-    if (obj->InheritsFrom("TPave")) continue;
+    TObject* obj = array->UncheckedAt(index);
+    if (!obj || obj->InheritsFrom("TPave")) continue;
 
-    option->ReadToken(options);
-    entryName->ReadLine(entries);
+    std::string option    = ReadToken(options);
+    std::string entryName = ReadLine(entries);
 
-    AddEntry(obj, entryName->Data(), option->Data());
+    AddEntry(obj, entryName.data(), option.data());
 
-    if (array->IndexOf(obj) ==  nEntries-1) break;
+    if (index == nEntries-1) break;
 
   }
 
@@ -84,8 +88,7 @@ Legend::Legend(TObjArray* array, std::string entr, std::string opt, std::string
 }
 
 //! Generate legend with dummy markers
-Legend::Legend(std::string obj, std::string entr, std::string opt, Int_t nEntries, std::string name): TLegend(0.1, 0.7, 0.3, 0.9),
-dummy(nEntries)
+Legend::Legend(std::string obj, std::string entr, std::string opt, Int_t nEntries, std::string name): TLegend(0.1, 0.7, 0.3, 0.9)
 {
 
   if (name  != "") fName = name;
@@ -94,58 +97,41 @@ dummy(nEntries)
   std::istringstream entries(entr);
   std::istringstream options(opt);
 
-  TString* option    = new TString();
-  TString* entryName = new TString();
-  TString* object    = new TString();
-
-  TString* color  = new TString();
-  TString* marker = new TString();
-  TString* size   = new TString();
-
   for(Int_t entry = 0; entry < nEntries; entry++){
 
-    object->ReadLine(objects);
-    std::istringstream token(object->Data());
-
-    color ->ReadToken(token);
-    marker->ReadToken(token);
-    size  ->ReadToken(token);
+    std::istringstream token(ReadLine(objects));
 
-    option->ReadToken(options);
-    entryName->ReadLine(entries);
+    std::string color  = ReadToken(token);
+    std::string marker = ReadToken(token);
+    std::string size   = ReadToken(token);
 
-    dummy[entry] = new TH1C();
-    Plot::SetPlottjectProperties(dummy[entry], color->Atoi(), marker->Atoi(), size->Atof());
+    std::string option    = ReadToken(options);
+    std::string entryName = ReadLine(entries);
 
-    AddEntry(dummy[entry], entryName->Data(), option->Data());
+    AddMarker(entryName, std::atoi(color.data()), std::atoi(marker.data()), std::atof(size.data()), option);
 
   }
 
 }
 
 //! Generate informative legend from string
-Legend::Legend(std::string entr, Int_t nEntries, std::string name): TLegend(0.1, 0.7, 0.3, 0.9),
-dummy(nEntries)
+Legend::Legend(std::string entr, Int_t nEntries, std::string name): TLegend(0.1, 0.7, 0.3, 0.9)
 {
 
   if (name  != "") fName = name;
 
   std::istringstream entries(entr);
-  TString* entryName = new TString();
 
   for(Int_t entry = 0; entry < nEntries; entry++){
 
-    entryName->ReadLine(entries);
-
-    AddEntry((TObject*)0x0, entryName->Data(), "");
+    AddEntry((TObject*)0x0, ReadLine(entries).data(), "");
 
   }
 
 }
 
 //! Copy constructor using objects
-Legend::Legend(Legend& lgnd, std::string name): TLegend(0.1, 0.7, 0.3, 0.9),
-  dummy(0)
+Legend::Legend(Legend& lgnd, std::string name): TLegend(0.1, 0.7, 0.3, 0.9)
 {
   if (name  != "") fName = name;
   fPrimitives = new TList();
@@ -156,8 +142,7 @@ Legend::Legend(Legend& lgnd, std::string name): TLegend(0.1, 0.7, 0.3, 0.9),
 }
 
 //! Copy constructor using pointers
-Legend::Legend(Legend* lgnd, std::string name): TLegend(0.1, 0.7, 0.3, 0.9),
-  dummy(0)
+Legend::Legend(Legend* lgnd, std::string name): TLegend(0.1, 0.7, 0.3, 0.9)
 {
   if (name  != "") fName = name;
   fPrimitives = new TList();
@@ -191,15 +176,212 @@ void Legend::SetPosition(Float_t x1, Float_t x2, Float_t y1, Float_t y2){
 
 }
 
+void Legend::SetPositionAuto(TLegend* l){
+
+  /** Flag a Legend to be placed automatically when the plot is drawn. The size of the
+      legend is kept, it is moved to the emptiest region of the frame that does not
+      collide with the drawn objects or any other legend in the same array **/
+
+  l->SetBit(kPositionAuto);
+
+}
+
 void Legend::SetPositionAuto(){
 
-  /** Determine automatic placement of Legend based on position strings **/
+  /** Flag the Legend to be placed automatically when the plot is drawn, see
+      the static function for details **/
+
+  SetBit(kPositionAuto);
+
+}
+
+void Legend::SetLayoutAuto(TLegend* l){
+
+  /** Flag a Legend to be sized automatically when the plot is drawn. Columns are
+      added until the entries fit into half of the frame height, the size of the
+      legend is determined from the (cached) widths of the entry texts **/
+
+  l->SetBit(kLayoutAuto);
+
+}
+
+void Legend::SetLayoutAuto(){
+
+  /** Flag the Legend to be sized automatically when the plot is drawn, see
+      the static function for details **/
+
+  SetBit(kLayoutAuto);
+
+}
+
+TLegendEntry* Legend::AddMarker(std::string entry, Color_t color, Style_t marker, Size_t size, std::string opt){
+
+  /** Add entry with a dummy marker. The marker and line properties are stored in the
+      legend entry itself, no object has to be created to carry them **/
 
-  /** \todo Get it to work**/
+  TLegendEntry* legendEntry = AddEntry((TObject*)0x0, entry.data(), opt.data());
+  Plot::SetPlottjectProperties(legendEntry, color, marker, size);
 
+  return legendEntry;
 
 }
 
+std::string Legend::ReadLine(std::istringstream& stream){
+
+  /** Read next line from \p stream, leading whitespace is skipped **/
+
+  std::string line;
+  stream >> std::ws;
+  std::getline(stream, line);
+
+  return line;
+
+}
+
+std::string Legend::ReadToken(std::istringstream& stream){
+
+  /** Read next whitespace separated token from \p stream **/
+
+  std::string token;
+  stream >> token;
+
+  return token;
+
+}
+
+// ----------------------------------------------------------------------------
+//                          LEGEND BUILDER CLASS
+// ----------------------------------------------------------------------------
+
+//! Class for building legends with many entries
+
+class LegendBuilder
+{
+
+public:
+
+  LegendBuilder(std::string title = "", std::string name = "");
+  ~LegendBuilder() {}
+
+  void Reserve(Int_t nEntries);
+  void Add(TObject* obj, std::string entry, std::string opt = "lp");
+  void Add(TObjArray* array, const std::vector<std::string>& entries, const std::vector<std::string>& opts = {});
+  void AddMarker(std::string entry, Color_t color, Style_t marker, Size_t size = 3., std::string opt = "p");
+  void AddText(std::string entry);
+  void SetLayoutAuto(Bool_t layout) {layoutAuto = layout;} //!< Toggle wether size and columns are fitted when the plot is drawn
+  void SetPositionAuto(Bool_t position) {positionAuto = position;} //!< Toggle wether the legend is placed automatically
+
+  Legend* Build();
+
+private:
+
+  //! Description of one legend entry
+  struct Entry {
+    TObject*    obj;     //!< Object of the entry, null for dummy markers and text
+    std::string label;   //!< Text of the entry
+    std::string opt;     //!< Draw option of the entry
+    Bool_t      marker;  //!< Is the entry a dummy marker?
+    Color_t     color;   //!< Color of the dummy marker
+    Style_t     style;   //!< Style of the dummy marker
+    Size_t      size;    //!< Size of the dummy marker
+  };
+
+  std::string title;                 //!< Title (first entry) of the legend
+  std::string name;                  //!< Name of the legend
+  std::vector<Entry> entries;        //!< Entries in order of appearance
+
+  Bool_t layoutAuto {kTRUE};         //!< Fit size and columns of the legend when drawn?
+  Bool_t positionAuto {kFALSE};      //!< Place legend automatically when drawn?
 
+};
+
+// ---- Constructor -----------------------------------------------------------
+
+//! Constructor
+LegendBuilder::LegendBuilder(std::string lTitle, std::string lName):
+  title(lTitle),
+  name(lName)
+{
+}
+
+// ---- Member Functions ------------------------------------------------------
+
+void LegendBuilder::Reserve(Int_t nEntries){
+
+  /** Reserve space for \p nEntries entries **/
+
+  entries.reserve(nEntries);
+
+}
+
+void LegendBuilder::Add(TObject* obj, std::string entry, std::string opt){
+
+  /** Add entry for a plottable object **/
+
+  entries.push_back({obj, std::move(entry), std::move(opt), kFALSE, 0, 0, 0});
+
+}
+
+void LegendBuilder::Add(TObjArray* array, const std::vector<std::string>& labels, const std::vector<std::string>& opts){
+
+  /** Add one entry for every object in \p array (legends and other paves are skipped)
+      using the corresponding element of \p labels and \p opts. Missing options default
+      to "lp", adding stops when the labels run out. **/
+
+  if (!array) {
+    std::cout << "\033[1;31mERROR:\033[0m Array is empty! Try again!" << std::endl;
+    return;
+  }
+
+  entries.reserve(entries.size() + labels.size());
+
+  Int_t label = 0;
+  for (Int_t index = 0; index < array->GetEntriesFast() && label < (Int_t)labels.size(); index++){
+
+    TObject* obj = array->UncheckedAt(index);
+    if (!obj || obj->InheritsFrom("TPave")) continue;
+
+    Add(obj, labels[label], (label < (Int_t)opts.size()) ? opts[label] : "lp");
+    label++;
+
+  }
+
+}
+
+void LegendBuilder::AddMarker(std::string entry, Color_t color, Style_t marker, Size_t size, std::string opt){
+
+  /** Add entry with a dummy marker **/
+
+  entries.push_back({nullptr, std::move(entry), std::move(opt), kTRUE, color, marker, size});
+
+}
+
+void LegendBuilder::AddText(std::string entry){
+
+  /** Add entry containing only text **/
+
+  entries.push_back({nullptr, std::move(entry), "", kFALSE, 0, 0, 0});
+
+}
+
+Legend* LegendBuilder::Build(){
+
+  /** Generate the legend from all added entries, the builder can be reused afterwards **/
+
+  Legend* legend = new Legend("", 0, name);
+
+  if (title != "") legend->AddEntry((TObject*)0x0, title.data(), "");
+
+  for (const Entry& entry : entries){
+    if (entry.marker) legend->AddMarker(entry.label, entry.color, entry.style, entry.size, entry.opt);
+    else legend->AddEntry(entry.obj, entry.label.data(), entry.opt.data());
+  }
+
+  if (layoutAuto)   legend->SetLayoutAuto();
+  if (positionAuto) legend->SetPositionAuto();
+
+  return legend;
+
+}
 
 //
@@ -10,12 +10,14 @@
 
 #include "TH1.h"
 #include "THn.h"
+#include "THnSparse.h"
 #include "TLatex.h"
 #include "TObjArray.h"
 #include "TPad.h"
 #include "TCanvas.h"
 
 #include "TLegend.h"
+#include "TLegendEntry.h"
 #include "TPaveText.h"
 #include "TFile.h"
 #include "TGraphErrors.h"
@@ -23,21 +25,58 @@
 #include "TMultiGraph.h"
 #include "TStyle.h"
 #include "TH2.h"
+#include "TProfile.h"
 #include "TF1.h"
 #include "TMarker.h"
 #include "TRandom.h"
 #include "TImage.h"
 #include "TTimeStamp.h"
 #include "TMath.h"
+#include "TROOT.h"
+#include "TMemFile.h"
+#include "TKey.h"
+#include "TTF.h"
+#include "TSystem.h"
+#include "TBufferJSON.h"
+#include "TList.h"
+#include "Math/MinimizerOptions.h"
+#include "Math/WrappedMultiTF1.h"
+#include "Fit/Fitter.h"
+#include "Fit/BinData.h"
+#include "HFitInterface.h"
 
 #include "TString.h"
 
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <unordered_map>
 #include <typeinfo>
 #include <algorithm>
 #include <numeric>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <cfloat>
+#include <cctype>
+#include <cstring>
+#include <cerrno>
+#include <map>
+#include <list>
+#include <set>
+#include <memory>
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include <charconv>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <zlib.h>
 
 #ifndef COLOR_H
   #include "Color.h"
@@ -47,6 +86,26 @@
   #include "functionality.h"
 #endif
 
+#ifndef INGEST_H
+  #include "Ingest.h"
+#endif
+
+#ifndef SAMPLER_H
+  #include "Sampler.h"
+#endif
+
+#ifndef LAYOUT_H
+  #include "Layout.h"
+#endif
+
+#ifndef RASTER_H
+  #include "Raster.h"
+#endif
+
+#ifndef BOOKLET_H
+  #include "Booklet.h"
+#endif
+
 #ifndef BASE_H
   #include "PlotBase.h"
 #endif
@@ -58,3 +117,23 @@
 #ifndef LEGEND_H
   #include "Legend.h"
 #endif
+
+#ifndef SPEC_H
+  #include "Spec.h"
+#endif
+
+#ifndef CHANNEL_H
+  #include "Channel.h"
+#endif
+
+#ifndef DAEMON_H
+  #include "Daemon.h"
+#endif
+
+#ifndef CACHE_H
+  #include "Cache.h"
+#endif
+
+#ifndef PROJECTION_H
+  #include "Projection.h"
+#endif
@@ -10,6 +10,45 @@
 
 #define BASE_H
 
+// ----------------------------------------------------------------------------
+//
+//                         COPY ON WRITE HELPER
+//
+// ----------------------------------------------------------------------------
+
+//! Value shared between copies of a plot until one of them changes it
+
+template <class T>
+class CopyOnWrite
+{
+
+public:
+
+  CopyOnWrite(): data(std::make_shared<T>()) {}
+  CopyOnWrite(T value): data(std::make_shared<T>(std::move(value))) {}
+
+  CopyOnWrite& operator=(T value) {data = std::make_shared<T>(std::move(value)); return *this;} //!< Replace the value, copies keep the old one
+
+  const T& operator*()  const {return *data;}      //!< Read access
+  const T* operator->() const {return data.get();} //!< Read access
+  T& Write();
+
+private:
+
+  std::shared_ptr<T> data;   //!< Value, shared with all copies that did not change it yet
+
+};
+
+template <class T>
+T& CopyOnWrite<T>::Write(){
+
+  /** Write access, the value is copied first if it is shared with another plot **/
+
+  if (data.use_count() > 1) data = std::make_shared<T>(*data);
+  return *data;
+
+}
+
 // ----------------------------------------------------------------------------
 //
 //                         PLOT BASE CLASS
@@ -30,11 +69,49 @@ public:
     Auto          //!< Placeholder
   };
 
+  //! Enumerator for choice of how Refresh detects changed inputs
+  enum Change : unsigned int {
+    Entries,      //!< Number of entries of histograms and points of graphs
+    Checksum,     //!< Contents and errors of all bins and points
+    DirtyFlag     //!< Only objects marked by the producer via MarkDirty
+  };
+
+  //! Style settings shared between all plots (cf. SaveStyle)
+  struct SharedStyle {
+    Int_t palette;                  //!< Color Palette
+    Bool_t inversion;               //!< Should palette be inverted?
+    std::vector<Int_t>   palColors; //!< Color vector of personalised palette
+    std::vector<Color_t> colors;    //!< Object colors
+    std::vector<Style_t> markers;   //!< Object marker style
+    std::vector<Size_t>  sizes;     //!< Object marker size
+    std::vector<Style_t> lstyles;   //!< Object line style
+    std::vector<Size_t>  lwidths;   //!< Object line width
+    Bool_t  styles;                 //!< Were styles set manually?
+    Style_t font;                   //!< Font style
+    Style_t label;                  //!< Label size
+    Int_t   mOffset;                //!< Offset for style array index
+  };
+
   Plot();
   Plot(TString xTitle, TString yTitle);
   virtual ~Plot() {}
 
   /*virtual*/ void Draw() {} //!< Abstract template for function
+  void Draw(Booklet& booklet, TString title = "");
+  void Draw(TString outname, std::vector<UInt_t> widths);
+  TString ToJSON(Int_t maxPoints = 0);
+  Bool_t ExportJSON(TString outname, Int_t maxPoints = 0);
+  virtual void BuildCanvas() {} //!< Abstract template for function
+  virtual void ReleaseCanvas();
+  virtual Bool_t Validate(std::vector<std::string>& problems);
+  Bool_t Validate();
+  static void SetCanvasPool(Bool_t use = kTRUE);
+  static void ClearCanvasPool();
+  static void SetRasterBackend(Bool_t use = kTRUE);
+  static void SetFunctionSampling(Bool_t use = kTRUE);
+  Bool_t Refresh(TString outname, Bool_t force = kFALSE);
+  static void SetChangeDetection(Change change) {detection = change;} //!< Choose how Refresh detects changed inputs
+  static void MarkDirty(TObject* obj) {obj->SetBit(dirtyBit);}       //!< Mark \p obj as changed for the DirtyFlag detection
 
   template <class PO> static void SetLineProperties(PO* pobj, Color_t color, Style_t lstyle, Size_t lwid = 2.);
   template <class PO> static void SetMarkerProperties(PO* pobj, Color_t color, Style_t mstyle, Size_t msize = 3.);
@@ -49,6 +126,9 @@ public:
   void SetOffset(Int_t off);
 
   void SetMode(Mode m);
+  static void ResetStyle();
+  static SharedStyle SaveStyle();
+  static void RestoreStyle(const SharedStyle& style);
   void SetStyle(std::vector<Color_t> col, std::vector<Style_t> mark, std::vector<Size_t> siz = {}, std::vector<Style_t> lstyl = {}, std::vector<Size_t> lwid = {});
   void ToggleStyle() { styles = !styles; } //!< Toggle wether style arrays are used. Note that SetStyles will automatically set this to on.
   void SetPalette(Int_t pal, Bool_t invert = kFALSE);
@@ -57,9 +137,32 @@ public:
   /*virtual*/ void SetOptions(std::vector<std::string> optns);
   virtual void SetOptions(std::string optns, std::string postns, Int_t off = 0);
   void SetOption(std::string opt, Int_t pos);
+  void SetMarginsAuto(Bool_t fit = kTRUE) {marginsAuto = fit;} //!< Toggle wether margins and title offsets are fitted to the axis labels and titles
+  Bool_t IsBroken() const {return broken;} //!< Did any fatal error occur?
 
 protected:
 
+  //! Canvas and input fingerprints kept between two calls of Refresh, never shared with copies of the plot
+  struct Monitor {
+    TCanvas* canvas {nullptr};                  //!< Canvas kept alive between refreshes
+    std::vector<TPad*> pads;                    //!< Pads of the canvas, in the order of GetPadArrays
+    std::vector<ULong64_t> fingerprints;        //!< Fingerprints of the pad arrays at the last refresh
+    TString outname;                            //!< File written by the last refresh
+
+    Monitor() {}
+    Monitor(const Monitor&) {}                          //!< Copies start without a canvas
+    Monitor& operator=(const Monitor&) {return *this;}  //!< Copies start without a canvas
+    ~Monitor();
+  };
+
+  //! Objects of a canvas replaced by reduced copies while it is serialized
+  struct Reduction {
+    Int_t maxPoints {0};                                      //!< Largest number of bins or points kept per object
+    std::map<TObject*, TObject*> copies;                      //!< Reduced copy of each replaced object
+    std::vector<std::pair<TObjLink*, TObject*>> links;        //!< Replaced links and their original objects
+    std::vector<TLegend*> legends;                            //!< Legends whose entries may refer to replaced objects
+  };
+
   void EnsureAxes(TObject* first, std::string arrayName = "");
   template <class AO> void SetCanvasStyle(AO* first, Float_t xOff, Float_t yOff);
   template <class AO> void SetPadStyle(AO* first, TString xTitle, TString yTitle, Float_t xUp, Float_t xLow, Float_t yUp, Float_t yLow);
@@ -67,11 +170,35 @@ protected:
   template <class AO> void SuppressXaxis(AO* first);
   template <class AO> void SuppressYaxis(AO* first);
   void SetUpStyle(TObject* first, TString xTitle, TString yTitle, Float_t xUp, Float_t xLow, Float_t yUp, Float_t yLow, Float_t xOff, Float_t yOff);
+  TCanvas* AcquireCanvas(TString title, Int_t x, Int_t y, Int_t w, Int_t h, TString layout = "");
+  TPad* AcquirePad(const char* name, const char* title, Double_t x1, Double_t y1, Double_t x2, Double_t y2);
   void SetUpPad(TPad* pad, Bool_t xLog, Bool_t yLog);
+  void SetUpPalette();
   void DrawArray(TObjArray* array, Int_t off = 0, Int_t offOpt = 0);
+  void PlaceLegends(TObjArray* array, TPad* pad, Float_t yLow, Float_t yUp);
+  void LayoutLegends(TObjArray* array, OccupancyGrid& grid, UInt_t padWidth, UInt_t padHeight, std::vector<std::string>* problems = nullptr);
+  Bool_t ValidateArray(TObjArray* array, std::string arrayName, Int_t offOpt, std::vector<std::string>& problems, Bool_t axes = kTRUE);
+  void ValidateRangesAuto(TObject* first, Float_t& xLow, Float_t& xUp, Float_t& yLow, Float_t& yUp, std::vector<std::string>& problems);
+  void ValidateFrame(TObjArray* array, std::string arrayName, UInt_t padWidth, UInt_t padHeight, Float_t bottom, Float_t top, Float_t xLow, Float_t xUp, Float_t yLow, Float_t yUp, Bool_t yLog, std::vector<std::string>& problems);
+  static void ValidateLog(Bool_t log, Float_t low, std::string axis, std::vector<std::string>& problems);
+  void FitMargins(TPad* pad, TObject* first, Float_t yLow, Float_t yUp, Bool_t xAxis = kTRUE);
+  static TAxis* GetAxis(TObject* first, Int_t axis);
+  static std::vector<std::string> GetAxisLabels(Float_t low, Float_t up, Bool_t log, Int_t nDivisions);
+  std::unique_ptr<RasterImage> PaintRaster(TObjArray* array, Double_t zoom = 1.);
+  Bool_t DrawRaster(TObjArray* array, TString outname);
+  virtual TObjArray* GetRasterArray() {return nullptr;}  //!< Array painted by the raster backend, nullptr if the plot class is not supported
+  virtual void RasterLines(std::vector<TLine>&) {} //!< Lines drawn directly onto the pad by the derived class, for the raster backend
+  static void ReduceList(TList* list, Reduction& reduction);
+  virtual std::vector<std::pair<TPad*, TObjArray*>> GetPadArrays() {return {};} //!< Pads of the plot and the arrays drawn into them, for Refresh
+  virtual void PrepareArrays() {} //!< Brings arrays filled by the plot itself up to date, before Refresh checks them
+  static ULong64_t Fingerprint(TObjArray* array, ULong64_t previous);
+  static TH1* ReduceHistogram(TH1* hist, Int_t maxPoints);
+  static TGraph* ReduceGraph(TGraph* graph, Int_t maxPoints);
 
   TPad    *mainPad {nullptr};             //!< Main pad
   TCanvas *canvas  {nullptr};             //!< Main canvas
+  Bool_t   pooled  {kFALSE};              //!< Is the canvas owned by the canvas pool?
+  Monitor  monitor;                       //!< State of the monitoring mode (cf. Refresh)
 
   static Int_t palette;                   //!< Color Palette
   static Bool_t inversion;                //!< Should palette be inverted?
@@ -82,7 +209,7 @@ protected:
   static std::vector<Style_t> lstyles;    //!< Object line style
   static std::vector<Size_t>  sizes;      //!< Object marker size
   static std::vector<Size_t>  lwidths;    //!< Object line width
-  std::vector<std::string>    options;    //!< Drawing options
+  CopyOnWrite<std::vector<std::string>> options; //!< Drawing options, shared with copies of the plot until changed
 
   TString titleX;                         //!< Title of X-axis
   TString titleY;                         //!< Title of Y-axis
@@ -104,6 +231,7 @@ protected:
   Float_t xRangeUp {100};                 //!< Upper X-axis range
 
   Bool_t  ranges {kFALSE};                //!< Were ranges set manually?
+  Bool_t  marginsAuto {kFALSE};           //!< Should margins and offsets be fitted automatically?
   Bool_t  broken {kFALSE};                //!< Did any fatal error occur?
 
   static Bool_t  styles;                  //!< Were styles set manually?
@@ -113,6 +241,12 @@ protected:
 
   static Int_t   mOffset;                 //!< Offset for style array index
 
+  static Bool_t  pooling;                 //!< Are canvases reused between plots?
+  static std::map<std::string, TCanvas*> canvasPool; //!< Reusable canvases by title, dimensions and layout
+  static Bool_t  rasterBackend;           //!< Are simple plots saved as PNG painted by the raster backend?
+  static Change  detection;               //!< How Refresh detects changed inputs
+  static const UInt_t dirtyBit;           //!< Object bit set by MarkDirty
+
 };
 
 // ---- Constructors ----------------------------------------------------------
@@ -149,6 +283,12 @@ Style_t Plot::label {28};
 Bool_t  Plot::styles {kFALSE};
 Int_t   Plot::mOffset {0};
 
+Bool_t  Plot::pooling {kFALSE};
+std::map<std::string, TCanvas*> Plot::canvasPool;
+Bool_t  Plot::rasterBackend {kFALSE};
+Plot::Change Plot::detection {Plot::Checksum};
+const UInt_t Plot::dirtyBit = BIT(23);
+
 // ---- Member Functions ------------------------------------------------------
 
 template <class AO>
@@ -257,7 +397,7 @@ void Plot::SetProperties(TObject* obj, Int_t index){
   size   = (index < sizes.size())   ? sizes[index]   : 2.;
   lstyle = (index < lstyles.size()) ? lstyles[index] : 1;
   lwidth = (index < lwidths.size()) ? lwidths[index] : 2.;
-  color  = (index < colors.size())  ? colors[index] : kBlack;
+  color  = (index < colors.size())  ? colors[index] : (Color_t)kBlack;
   marker = (index < markers.size()) ? markers[index] : kFullCircle;
 
   if (obj->InheritsFrom("TH1")) {
@@ -434,6 +574,58 @@ void Plot::SetMode(Mode m){
 
  }
 
+void Plot::ResetStyle(){
+
+  /** Resets all style settings shared between plots (style arrays, palette,
+      fonts and offsets) to their defaults **/
+
+  palette   = 109;
+  inversion = kFALSE;
+  palColors.clear();
+
+  colors.clear();
+  markers.clear();
+  sizes.clear();
+  lstyles.clear();
+  lwidths.clear();
+  styles = kFALSE;
+
+  font    = 43;
+  label   = 28;
+  mOffset = 0;
+
+}
+
+Plot::SharedStyle Plot::SaveStyle(){
+
+  /** Returns all style settings shared between plots, e.g. to restore them
+      after drawing plots with other styles (cf. RestoreStyle) **/
+
+  return {palette, inversion, palColors, colors, markers, sizes, lstyles, lwidths, styles, font, label, mOffset};
+
+}
+
+void Plot::RestoreStyle(const SharedStyle& style){
+
+  /** Sets all style settings shared between plots to \p style (cf. SaveStyle) **/
+
+  palette   = style.palette;
+  inversion = style.inversion;
+  palColors = style.palColors;
+
+  colors  = style.colors;
+  markers = style.markers;
+  sizes   = style.sizes;
+  lstyles = style.lstyles;
+  lwidths = style.lwidths;
+  styles  = style.styles;
+
+  font    = style.font;
+  label   = style.label;
+  mOffset = style.mOffset;
+
+}
+
 void Plot::SetStyle(std::vector<Color_t> col, std::vector<Style_t> mark, std::vector<Size_t> siz, std::vector<Style_t> lstyl, std::vector<Size_t> lwid){
 
   /** Set style arrays for the histograms and functions **/
@@ -479,9 +671,7 @@ void Plot::SetOptions(TString opt){
 
   /** Set one plot option for all plottjects **/
 
-  Int_t size = options.size();
-  options.clear();
-  options.resize(size, opt.Data());
+  options = std::vector<std::string>(options->size(), opt.Data());
 
 }
 
@@ -526,7 +716,7 @@ void Plot::SetOption(std::string opt, Int_t pos){
   /** Set the plot option for a specific plottject
       mind that any legend or pave object is also included in the options **/
 
-  if (pos < options.size()) options[pos] = opt;
+  if (pos < options->size()) options.Write()[pos] = opt;
   else std::cout << "\033[1;31mERROR in Set Options:\033[0m Position \033[1;34m" << pos << "\033[0m is out of range!" << std::endl;
 
 }
@@ -536,11 +726,7 @@ void Plot::SetUpPad(TPad* pad, Bool_t xLog, Bool_t yLog){
   /** Sets up a Pad for Plotting **/
 
   gStyle->SetOptTitle(0);
-  gStyle->SetPalette(palette, palColors.empty() ? 0 : palColors.data());
-  if ((inversion && !inverted) || (!inversion && inverted)){
-     TColor::InvertPalette();
-     inverted = !inverted;
-  }
+  SetUpPalette();
 
   pad->SetFillStyle(4100); //4000
   pad->SetTopMargin(topMargin);
@@ -561,6 +747,18 @@ void Plot::SetUpPad(TPad* pad, Bool_t xLog, Bool_t yLog){
 
 }
 
+void Plot::SetUpPalette(){
+
+  /** Activates the chosen palette in gStyle **/
+
+  gStyle->SetPalette(palette, palColors.empty() ? 0 : palColors.data());
+  if ((inversion && !inverted) || (!inversion && inverted)){
+     TColor::InvertPalette();
+     inverted = !inverted;
+  }
+
+}
+
 void Plot::EnsureAxes(TObject* first, std::string arrayName){
 
   /** Ensure that first object in array to be plotted has well defined axes **/
@@ -584,6 +782,728 @@ void Plot::EnsureAxes(TObject* first, std::string arrayName){
 
 }
 
+void Plot::Draw(Booklet& booklet, TString title){
+
+  /** Draws the plot as the next page of \p booklet, using \p title as its
+      bookmark and table of contents entry. The canvas only lives as long as
+      it takes to write the page, so booklets of arbitrary length can be
+      filled without keeping the previous pages in memory. **/
+
+  if (broken){
+    std::cout << "Due to one or more \033[1;33mFATAL ERRORS\033[0m your Plot will not be added to "
+              << booklet.GetFileName() << std::endl;
+    return;
+  }
+
+  BuildCanvas();
+  if (!canvas) return;
+
+  booklet.AddPage(canvas, title);
+  ReleaseCanvas();
+
+}
+
+void Plot::Draw(TString outname, std::vector<UInt_t> widths){
+
+  /** Draws the plot once and writes it as PNG in all \p widths (pixels, the
+      heights follow the aspect ratio of the canvas), named <outname>_<width>.png.
+      The plot is painted a single time at the largest width, with all fonts,
+      lines and markers scaled along, and the smaller images are reduced from
+      it. All images are encoded in parallel. **/
+
+  if (broken){
+    std::cout << "Due to one or more \033[1;33mFATAL ERRORS\033[0m your Plot will not be drawn" << std::endl;
+    return;
+  }
+
+  if (!outname.EndsWith(".png") || widths.empty()){
+    std::cout << "\033[1;31mERROR:\033[0m Multiple resolutions need a .png file and at least one width! Plot will not be drawn." << std::endl;
+    return;
+  }
+
+  std::sort(widths.begin(), widths.end(), std::greater<UInt_t>());
+  widths.erase(std::unique(widths.begin(), widths.end()), widths.end());
+
+  TString stem = outname(0, outname.Length() - 4);
+  std::vector<std::string> names;
+  for (UInt_t w : widths) names.push_back(Form("%s_%u.png", stem.Data(), w));
+
+  Double_t zoom = widths[0]/width;
+  Int_t first = 0;  // first image that still needs to be written
+
+  std::unique_ptr<RasterImage> image;
+  if (rasterBackend && GetRasterArray()) image = PaintRaster(GetRasterArray(), zoom);
+
+  if (!image){
+
+    // ROOT paints and writes the largest image itself, the smaller ones are reduced from it
+    BuildCanvas();
+    if (!canvas) return;
+
+    Float_t scaling = gStyle->GetImageScaling();
+    gStyle->SetImageScaling(zoom);
+    canvas->SaveAs(names[0].data());
+    gStyle->SetImageScaling(scaling);
+    ReleaseCanvas();
+
+    TImage* written = TImage::Open(names[0].data());
+    if (!written){
+      std::cout << "\033[1;31mERROR:\033[0m " << names[0] << " could not be read back! Smaller images will not be written." << std::endl;
+      return;
+    }
+    image.reset(new RasterImage(RasterImage::FromArgb(written->GetArgbArray(), written->GetWidth(), written->GetHeight())));
+    delete written;
+    first = 1;
+
+  }
+
+  Double_t aspect = (Double_t)image->GetHeight()/image->GetWidth();
+  std::vector<char> written(widths.size(), kTRUE);  // not Bool_t: std::vector<bool> packs bits, which races between threads
+
+  ParallelFor(widths.size() - first, [&](Int_t index){
+    index += first;
+    UInt_t w = std::min(widths[index], image->GetWidth());
+    UInt_t h = std::max(std::min((UInt_t)TMath::Nint(w*aspect), image->GetHeight()), 1u);
+    written[index] = image->Downscale(w, h).WritePNG(names[index]);
+  });
+
+  for (UInt_t index = first; index < widths.size(); index++){
+    if (written[index]) std::cout << "Info: png file " << names[index] << " has been created" << std::endl;
+  }
+
+}
+
+TString Plot::ToJSON(Int_t maxPoints){
+
+  /** Serializes the configured canvas with all pads, objects, styles, ranges
+      and legends via TBufferJSON, in the compact form read by JSROOT, so the
+      plot can be painted in the browser instead of on the server.
+      If \p maxPoints is given, histograms with more bins and graphs with more
+      points are serialized as reduced copies: bins are averaged in groups (per
+      axis for TH2), graphs keep the lowest and highest point of each group of
+      points so peaks stay visible. The objects of the plot are not changed. **/
+
+  if (broken){
+    std::cout << "Due to one or more \033[1;33mFATAL ERRORS\033[0m your Plot will not be exported" << std::endl;
+    return "";
+  }
+
+  BuildCanvas();
+  if (!canvas) return "";
+
+  Reduction reduction;
+  reduction.maxPoints = maxPoints;
+  if (maxPoints > 0) ReduceList(canvas->GetListOfPrimitives(), reduction);
+
+  std::vector<std::pair<TLegendEntry*, TObject*>> entries;
+  for (TLegend* legend : reduction.legends){
+    TIter next(legend->GetListOfPrimitives());
+    while (TLegendEntry* entry = (TLegendEntry*)next()){
+      auto copy = reduction.copies.find(entry->GetObject());
+      if (copy == reduction.copies.end()) continue;
+      entries.push_back(std::make_pair(entry, copy->first));
+      TString label = entry->GetLabel();
+      entry->SetObject(copy->second);
+      entry->SetLabel(label);
+    }
+  }
+
+  TString json = TBufferJSON::ToJSON(canvas, 23); // no spaces, repeated values suppressed
+
+  for (auto& link : reduction.links) link.first->SetObject(link.second);
+  for (auto& entry : entries){
+    TString label = entry.first->GetLabel();
+    entry.first->SetObject(entry.second);
+    entry.first->SetLabel(label);
+  }
+  for (auto& copy : reduction.copies) delete copy.second;
+
+  ReleaseCanvas();
+
+  return json;
+
+}
+
+Bool_t Plot::ExportJSON(TString outname, Int_t maxPoints){
+
+  /** Writes the JSON of the plot (cf. ToJSON) to \p outname **/
+
+  TString json = ToJSON(maxPoints);
+  if (json.IsNull()) return kFALSE;
+
+  std::ofstream file(outname.Data());
+  file << json.Data();
+  if (!file.good()){
+    std::cout << "\033[1;31mERROR:\033[0m " << outname << " could not be written!" << std::endl;
+    return kFALSE;
+  }
+
+  std::cout << "Info: json file " << outname << " has been created" << std::endl;
+  return kTRUE;
+
+}
+
+void Plot::ReduceList(TList* list, Reduction& reduction){
+
+  /** Replaces all large histograms and graphs in \p list by reduced copies,
+      descending into pads and multigraphs. Objects drawn several times share
+      one copy. **/
+
+  if (!list) return;
+
+  for (TObjLink* link = list->FirstLink(); link; link = link->Next()){
+
+    TObject* obj = link->GetObject();
+    if (!obj) continue;
+
+    if (obj->InheritsFrom("TPad")) ReduceList(((TPad*)obj)->GetListOfPrimitives(), reduction);
+    else if (obj->InheritsFrom("TMultiGraph")) ReduceList(((TMultiGraph*)obj)->GetListOfGraphs(), reduction);
+    else if (obj->InheritsFrom("TLegend")) reduction.legends.push_back((TLegend*)obj);
+    else {
+
+      TObject* copy = nullptr;
+      auto known = reduction.copies.find(obj);
+      if (known != reduction.copies.end()) copy = known->second;
+      else if (obj->InheritsFrom("TProfile") || obj->InheritsFrom("TProfile2D")) continue; // bins are not plain values
+      else if (obj->InheritsFrom("TH1")) copy = ReduceHistogram((TH1*)obj, reduction.maxPoints);
+      else if (obj->InheritsFrom("TGraph")) copy = ReduceGraph((TGraph*)obj, reduction.maxPoints);
+
+      if (!copy) continue;
+      reduction.copies[obj] = copy;
+      reduction.links.push_back(std::make_pair(link, obj));
+      link->SetObject(copy);
+
+    }
+
+  }
+
+}
+
+TH1* Plot::ReduceHistogram(TH1* hist, Int_t maxPoints){
+
+  /** Returns a copy of \p hist with groups of bins merged into one, which
+      holds their mean, so that at most \p maxPoints bins are left.
+      Returns nullptr if \p hist is small enough or has more than two dimensions. **/
+
+  Int_t dim = hist->GetDimension();
+  Int_t nx = hist->GetNbinsX();
+  Int_t ny = (dim > 1) ? hist->GetNbinsY() : 1;
+  if (dim > 2 || (Long64_t)nx*ny <= maxPoints) return nullptr;
+
+  Int_t group = (dim == 1) ? TMath::CeilNint((Double_t)nx/maxPoints) : TMath::CeilNint(TMath::Sqrt((Double_t)nx*ny/maxPoints));
+  Int_t groupX = std::min(group, nx);
+  Int_t groupY = (dim > 1) ? std::min(group, ny) : 1;
+
+  // if one axis saturates (long, thin maps) or the groups are rounded, the other axis has to merge more bins
+  if (dim > 1){
+    Int_t binsY = (ny + groupY - 1)/groupY;
+    groupX = std::min(nx, std::max(groupX, TMath::CeilNint((Double_t)nx/std::max(maxPoints/binsY, 1))));
+    Int_t binsX = (nx + groupX - 1)/groupX;
+    groupY = std::min(ny, std::max(groupY, TMath::CeilNint((Double_t)ny/std::max(maxPoints/binsX, 1))));
+  }
+
+  // edges of the merged bins are a subset of the original edges, so variable binning is kept
+  std::vector<Double_t> xEdges, yEdges;
+  for (Int_t bin = 1; bin <= nx; bin += groupX) xEdges.push_back(hist->GetXaxis()->GetBinLowEdge(bin));
+  xEdges.push_back(hist->GetXaxis()->GetBinUpEdge(nx));
+  for (Int_t bin = 1; dim > 1 && bin <= ny; bin += groupY) yEdges.push_back(hist->GetYaxis()->GetBinLowEdge(bin));
+  if (dim > 1) yEdges.push_back(hist->GetYaxis()->GetBinUpEdge(ny));
+
+  TH1* copy = (TH1*)hist->Clone(Form("%s_lod", hist->GetName()));
+  copy->SetDirectory(nullptr);
+  if (dim == 1) copy->SetBins(xEdges.size() - 1, xEdges.data());
+  else copy->SetBins(xEdges.size() - 1, xEdges.data(), yEdges.size() - 1, yEdges.data());
+
+  for (Int_t by = 1; by <= (dim > 1 ? (Int_t)yEdges.size() - 1 : 1); by++){
+    for (Int_t bx = 1; bx < (Int_t)xEdges.size(); bx++){
+
+      Double_t sum = 0, error2 = 0;
+      Int_t nMerged = 0;
+      for (Int_t y = (by - 1)*groupY + 1; y <= std::min(by*groupY, ny); y++){
+        for (Int_t x = (bx - 1)*groupX + 1; x <= std::min(bx*groupX, nx); x++){
+          Int_t bin = hist->GetBin(x, y);
+          sum    += hist->GetBinContent(bin);
+          error2 += hist->GetBinError(bin)*hist->GetBinError(bin);
+          nMerged++;
+        }
+      }
+
+      Int_t bin = copy->GetBin(bx, by);
+      copy->SetBinContent(bin, sum/nMerged);
+      copy->SetBinError(bin, TMath::Sqrt(error2)/nMerged);
+
+    }
+  }
+
+  copy->SetEntries(hist->GetEntries());
+
+  // the ranges of the axes refer to bins, they are set again for the merged ones
+  for (Int_t axis = 0; axis < dim; axis++){
+    TAxis* original = (axis == 0) ? hist->GetXaxis() : hist->GetYaxis();
+    TAxis* reduced  = (axis == 0) ? copy->GetXaxis() : copy->GetYaxis();
+    if (original->TestBit(TAxis::kAxisRange)) reduced->SetRangeUser(original->GetBinLowEdge(original->GetFirst()), original->GetBinUpEdge(original->GetLast()));
+    else reduced->SetRange();
+  }
+
+  return copy;
+
+}
+
+TGraph* Plot::ReduceGraph(TGraph* graph, Int_t maxPoints){
+
+  /** Returns a copy of \p graph with at most \p maxPoints points: the points
+      are split into groups and only the lowest and the highest point of each
+      group are kept, together with their errors.
+      Returns nullptr if \p graph is small enough. **/
+
+  Int_t n = graph->GetN();
+  if (n <= std::max(maxPoints, 2)) return nullptr;
+
+  TGraph* copy = (TGraph*)graph->Clone(Form("%s_lod", graph->GetName()));
+
+  Double_t* y = copy->GetY();
+  std::vector<Double_t*> columns = {copy->GetX(), copy->GetY(), copy->GetEX(), copy->GetEY(), copy->GetEXlow(),
+                                    copy->GetEXhigh(), copy->GetEYlow(), copy->GetEYhigh()};
+
+  Int_t nGroups = std::max(maxPoints/2, 1);
+  Int_t kept = 0;
+
+  // points are moved to the front in place, kept never overtakes the group being read
+  for (Int_t group = 0; group < nGroups; group++){
+
+    Int_t begin = (Long64_t)group*n/nGroups;
+    Int_t end   = (Long64_t)(group + 1)*n/nGroups;
+
+    Int_t low = begin, up = begin;
+    for (Int_t point = begin; point < end; point++){
+      if (y[point] < y[low]) low = point;
+      if (y[point] > y[up]) up = point;
+    }
+
+    for (Int_t point : {std::min(low, up), std::max(low, up)}){
+      for (Double_t* column : columns) if (column) column[kept] = column[point];
+      kept++;
+      if (low == up) break;
+    }
+
+  }
+
+  copy->Set(kept);
+
+  return copy;
+
+}
+
+Bool_t Plot::Validate(std::vector<std::string>& problems){
+
+  /** Dry run of Draw: checks everything that would go wrong while drawing and
+      appends a description of each problem to \p problems, without creating
+      any canvas. The derived classes add the checks of their arrays, ranges
+      and legends. Returns wether no problem was found. **/
+
+  size_t nProblems = problems.size();
+
+  if (broken) problems.push_back("Plot is broken, see errors printed while setting it up");
+  if (width <= 0 || height <= 0) problems.push_back(Form("Canvas dimensions %g x %g are not positive", width, height));
+  if (leftMargin + rightMargin >= 1) problems.push_back("Left and right margin leave no space for the frame");
+  if (bottomMargin + topMargin >= 1) problems.push_back("Bottom and top margin leave no space for the frame");
+
+  return problems.size() == nProblems;
+
+}
+
+Bool_t Plot::Validate(){
+
+  /** Dry run of Draw, all problems found are printed **/
+
+  std::vector<std::string> problems;
+  if (Validate(problems)) return kTRUE;
+
+  for (const std::string& problem : problems) std::cout << "\033[1;31mERROR in Validate:\033[0m " << problem << std::endl;
+  return kFALSE;
+
+}
+
+Bool_t Plot::ValidateArray(TObjArray* array, std::string arrayName, Int_t offOpt, std::vector<std::string>& problems, Bool_t axes){
+
+  /** Checks the objects of \p array and their draw options, starting at \p offOpt.
+      Returns wether the first object can be used to set up the axes. **/
+
+  if (!array || !array->GetEntries()){
+    problems.push_back(arrayName + " is empty");
+    return kFALSE;
+  }
+
+  Int_t nObjects = array->GetEntries();
+  Int_t nOptions = (Int_t)options->size() - offOpt;
+  if (nObjects > nOptions) problems.push_back(arrayName + Form(" contains %d objects, but only %d draw options are given", nObjects, std::max(nOptions, 0)));
+
+  for (Int_t index = 0; index < nObjects; index++){
+
+    TObject* obj = array->At(index);
+    if (!obj){
+      problems.push_back(arrayName + Form(": object No %d is broken", index));
+      continue;
+    }
+
+    if (obj->InheritsFrom("TLegend") && !obj->TestBit(kPositionAuto)){
+      TLegend* legend = (TLegend*)obj;
+      if (legend->GetX1() >= legend->GetX2() || legend->GetY1() >= legend->GetY2()
+          || legend->GetX1() < 0 || legend->GetX2() > 1 || legend->GetY1() < 0 || legend->GetY2() > 1)
+        problems.push_back(arrayName + ": legend " + legend->GetName() + Form(" at (%g, %g, %g, %g) is not inside the pad",
+                           legend->GetX1(), legend->GetX2(), legend->GetY1(), legend->GetY2()));
+    }
+
+  }
+
+  TObject* first = array->At(0);
+  if (!first){
+    problems.push_back(arrayName + ": first entry doesn't exist");
+    return kFALSE;
+  }
+
+  if (axes && !first->InheritsFrom("TH1") && !first->InheritsFrom("TF1") && !first->InheritsFrom("TMultiGraph")){
+    problems.push_back(arrayName + ": first entry must have axes, but is a " + first->ClassName());
+    return kFALSE;
+  }
+
+  return kTRUE;
+
+}
+
+void Plot::ValidateRangesAuto(TObject* first, Float_t& xLow, Float_t& xUp, Float_t& yLow, Float_t& yUp, std::vector<std::string>& problems){
+
+  /** Computes the ranges that SetRangesAuto would choose for \p first,
+      without changing the plot **/
+
+  if (first->InheritsFrom("TF1")){
+    problems.push_back("Automatic ranges are not supported for a TF1 as first object, please use SetRanges");
+    return;
+  }
+
+  if (!first->InheritsFrom("TH1")) return;
+
+  TH1* hist = (TH1*)first;
+
+  yUp  = hist->GetMaximum();
+  yUp  = (yUp < 0) ? 0.8*yUp : 1.2*yUp;
+  yLow = hist->GetMinimum();
+  yLow = (yLow < 0) ? 1.2*yLow : 0.8*yLow;
+
+  xUp  = hist->GetXaxis()->GetBinCenter(GetXlastFilledBin(hist)+2);
+  xLow = hist->GetXaxis()->GetBinCenter(GetXfirstFilledBin(hist)-1);
+
+}
+
+void Plot::ValidateFrame(TObjArray* array, std::string arrayName, UInt_t padWidth, UInt_t padHeight, Float_t bottom, Float_t top, Float_t xLow, Float_t xUp, Float_t yLow, Float_t yUp, Bool_t yLog, std::vector<std::string>& problems){
+
+  /** Checks the ranges of a pad of \p padWidth x \p padHeight pixels and wether
+      all automatically placed legends of \p array fit into its frame **/
+
+  if (!(xLow < xUp)) problems.push_back(arrayName + Form(": X-range [%g, %g] is empty", xLow, xUp));
+  if (!(yLow < yUp)) problems.push_back(arrayName + Form(": Y-range [%g, %g] is empty", yLow, yUp));
+  if (!(xLow < xUp) || !(yLow < yUp)) return;
+
+  OccupancyGrid grid(leftMargin, 1 - rightMargin, bottom, 1 - top);
+  grid.SetRanges(xLow, xUp, yLow, yUp, logX && xLow > 0, yLog && yLow > 0);
+
+  LayoutLegends(array, grid, padWidth, padHeight, &problems);
+
+}
+
+void Plot::ValidateLog(Bool_t log, Float_t low, std::string axis, std::vector<std::string>& problems){
+
+  /** Checks a logarithmic axis the same way SetUpPad does **/
+
+  if (log && low <= 0) problems.push_back(axis + "-axis should be logarithmic, but its lower range is not above zero. Logarithm would not be set");
+
+}
+
+void Plot::ReleaseCanvas(){
+
+  /** Deletes the canvas together with all pads drawn onto it,
+      pooled canvases are kept for the next plot instead **/
+
+  if (!pooled) delete canvas;
+  canvas  = nullptr;
+  mainPad = nullptr;
+  pooled  = kFALSE;
+
+}
+
+void Plot::SetCanvasPool(Bool_t use){
+
+  /** Toggle wether canvases and pads are kept after drawing and reused by the
+      next plot with the same canvas title, dimensions and pad layout, instead
+      of being created and deleted for every plot **/
+
+  pooling = use;
+  if (!use) ClearCanvasPool();
+
+}
+
+void Plot::SetRasterBackend(Bool_t use){
+
+  /** Toggle wether plots saved as PNG are painted by the native raster backend
+      (cf. Raster.h) instead of the ROOT graphics. Only square and ratio plots
+      of one-dimensional histograms, graphs, functions, lines, markers and
+      legends are supported, all other plots are still drawn by ROOT. **/
+
+  rasterBackend = use;
+
+}
+
+void Plot::SetFunctionSampling(Bool_t use){
+
+  /** Toggle wether functions drawn on top of the first object are sampled
+      once (cf. FunctionSampler) and drawn as graphs, so that they are not
+      evaluated again for every pad, format and redraw. Turning it off
+      deletes the samples. **/
+
+  FunctionSampler::SetEnabled(use);
+  if (!use) FunctionSampler::Clear();
+
+}
+
+std::unique_ptr<RasterImage> Plot::PaintRaster(TObjArray* array, Double_t zoom){
+
+  /** Paints \p array into a single frame with the raster backend, on an image
+      \p zoom times the size of the canvas. Returns nullptr if any object cannot
+      be painted by the backend, the plot is then drawn by ROOT. **/
+
+  TObject* first = array->At(0);
+  if (!first->InheritsFrom("TH1") && !(first->InheritsFrom("TF1") && ranges)) return nullptr;
+  if (array->GetEntries() > (Int_t)options->size()) return nullptr;
+
+  TIter iArray(array);
+  while (TObject* obj = iArray()){
+    if (!RasterPainter::IsSupported(obj)) return nullptr;
+  }
+
+  if (!ranges && first->InheritsFrom("TH1")) SetRangesAuto((TH1*)first);
+  if (!(xRangeLow < xRangeUp) || !(yRangeLow < yRangeUp)) return nullptr;
+
+  if (logX && xRangeLow <= 0) std::cout << "\033[1;31mERROR in SetLog:\033[0m X-Ranges must be above zero! Logarithm not set!!" << std::endl;
+  if (logY && yRangeLow <= 0) std::cout << "\033[1;31mERROR in SetLog:\033[0m Y-Ranges must be above zero! Logarithm not set!!" << std::endl;
+
+  Int_t w = TMath::Nint(width*zoom), h = TMath::Nint(height*zoom);
+
+  std::unique_ptr<RasterImage> image(new RasterImage(w, h));
+  image->SetZoom(zoom);
+  image->SetFrame(TMath::Nint(leftMargin*w), TMath::Nint(topMargin*h), TMath::Nint((1 - rightMargin)*w), TMath::Nint((1 - bottomMargin)*h),
+                  xRangeLow, xRangeUp, yRangeLow, yRangeUp, logX, logY);
+
+  std::vector<TLine> lines;
+  RasterLines(lines);
+
+  for (Int_t plot = 0; plot < array->GetEntries(); plot++) SetProperties(array->At(plot), plot + mOffset);
+
+  OccupancyGrid grid(leftMargin, 1 - rightMargin, bottomMargin, 1 - topMargin);
+  grid.SetRanges(xRangeLow, xRangeUp, yRangeLow, yRangeUp, image->GetLogX(), image->GetLogY());
+  for (TLine& line : lines) grid.Fill(&line);
+  LayoutLegends(array, grid, TMath::Nint(width), TMath::Nint(height));
+
+  RasterPainter::PaintAxes(*image, titleX, titleY, offsetX, offsetY, RasterPainter::GetTextScale(*image, font, label));
+
+  for (Int_t plot = 0; plot < array->GetEntries(); plot++){
+    std::cout << " -> Paint " << array->At(plot)->ClassName() << ": "
+              << array->At(plot)->GetName() << " as " << (*options)[plot] << std::endl;
+    RasterPainter::Paint(*image, array->At(plot), (*options)[plot]);
+  }
+  for (TLine& line : lines) RasterPainter::Paint(*image, &line, "");
+
+  return image;
+
+}
+
+Bool_t Plot::DrawRaster(TObjArray* array, TString outname){
+
+  /** Paints \p array with the raster backend and writes it to \p outname as PNG.
+      Returns kFALSE without writing anything if the backend cannot paint the plot. **/
+
+  std::unique_ptr<RasterImage> image = PaintRaster(array);
+  if (!image || !image->WritePNG(outname)) return kFALSE;
+
+  std::cout << "Info: png file " << outname << " has been created by the raster backend" << std::endl;
+  return kTRUE;
+
+}
+
+Bool_t Plot::Refresh(TString outname, Bool_t force){
+
+  /** Monitoring mode of Draw, for plots redrawn periodically while their
+      inputs are refilled: the plot is only written again if any of its pads
+      changed since the last call (cf. SetChangeDetection), otherwise nothing
+      is done apart from checking the inputs. The canvas is kept alive between
+      calls. With fixed ranges only the changed pads are repainted, with
+      automatic ranges the canvas is set up again since the ranges follow the
+      contents. Settings changed in between (e.g. via Rebind) are only picked
+      up if \p force is set or the inputs changed.
+      Returns wether the plot was written. **/
+
+  if (broken) return kFALSE;
+
+  PrepareArrays();
+  std::vector<std::pair<TPad*, TObjArray*>> pads = GetPadArrays();
+  std::vector<ULong64_t> fingerprints(pads.size());
+  for (UInt_t pad = 0; pad < pads.size(); pad++)
+    fingerprints[pad] = Fingerprint(pads[pad].second, pad < monitor.fingerprints.size() ? monitor.fingerprints[pad] : 0);
+
+  Bool_t alive = monitor.canvas && gROOT->GetListOfCanvases()->FindObject(monitor.canvas);
+  Bool_t raster = rasterBackend && outname.EndsWith(".png") && GetRasterArray();
+
+  if (!force && (alive || raster) && outname == monitor.outname && fingerprints == monitor.fingerprints) return kFALSE;
+
+  Bool_t painted = raster && DrawRaster(GetRasterArray(), outname);
+
+  if (!painted && (force || !alive || !ranges || outname != monitor.outname || pads.size() != monitor.pads.size())){
+
+    BuildCanvas();  // reuses the kept canvas (cf. AcquireCanvas)
+    if (!canvas) return kFALSE;
+
+    for (auto& pooledCanvas : canvasPool){
+      if (pooledCanvas.second == canvas) pooledCanvas.second = nullptr;  // the canvas now belongs to this plot only
+    }
+
+    monitor.canvas = canvas;
+    monitor.pads.clear();
+    for (auto& pad : GetPadArrays()) monitor.pads.push_back(pad.first);
+
+    canvas->SaveAs(outname.Data());
+
+  }
+  else if (!painted){
+
+    for (UInt_t pad = 0; pad < pads.size(); pad++){
+      if (fingerprints[pad] == monitor.fingerprints[pad]) continue;
+      if (FunctionSampler::IsEnabled()){
+        // sampled graphs are updated in place, so the functions drawn from them (cf. DrawArray) are resampled here
+        for (Int_t index = 1; index < pads[pad].second->GetEntriesFast(); index++){
+          TObject* obj = pads[pad].second->At(index);
+          if (obj && obj->InheritsFrom("TF1")) FunctionSampler::Sample((TF1*)obj, monitor.pads[pad]->GetLogx());
+        }
+      }
+      monitor.pads[pad]->Modified();
+    }
+    monitor.canvas->Update();
+    monitor.canvas->SaveAs(outname.Data());
+
+  }
+
+  canvas  = nullptr;
+  mainPad = nullptr;
+  pooled  = kFALSE;
+
+  monitor.fingerprints = fingerprints;
+  monitor.outname = outname;
+
+  return kTRUE;
+
+}
+
+ULong64_t Plot::Fingerprint(TObjArray* array, ULong64_t previous){
+
+  /** Summarizes the state of all objects in \p array as chosen via
+      SetChangeDetection, equal fingerprints mean nothing has to be repainted.
+      For DirtyFlag, \p previous is counted up if any object was marked, and
+      the marks are removed. **/
+
+  if (detection == DirtyFlag){
+    Bool_t dirty = kFALSE;
+    TIter next(array);
+    while (TObject* obj = next()){
+      if (!obj->TestBit(dirtyBit)) continue;
+      obj->ResetBit(dirtyBit);
+      dirty = kTRUE;
+    }
+    return previous + dirty;
+  }
+
+  ULong64_t hash = 14695981039346656037ULL;
+  TIter next(array);
+  while (TObject* obj = next()) hash = HashObject(obj, detection == Checksum, hash);
+
+  return hash;
+
+}
+
+Plot::Monitor::~Monitor(){
+
+  /** Deletes the canvas kept by Refresh **/
+
+  if (canvas && gROOT->GetListOfCanvases()->FindObject(canvas)) delete canvas;
+
+}
+
+void Plot::ClearCanvasPool(){
+
+  /** Deletes all pooled canvases **/
+
+  for (auto& pooledCanvas : canvasPool){
+    if (gROOT->GetListOfCanvases()->FindObject(pooledCanvas.second)) delete pooledCanvas.second;
+  }
+  canvasPool.clear();
+
+}
+
+TCanvas* Plot::AcquireCanvas(TString title, Int_t x, Int_t y, Int_t w, Int_t h, TString layout){
+
+  /** Returns a new canvas, or a cleared canvas from the pool if pooling is
+      switched on. The canvas kept by Refresh is always reused. \p layout distinguishes different pad layouts with the
+      same title and dimensions. The canvas is the current pad afterwards. **/
+
+  TCanvas* c = nullptr;
+  pooled = pooling;
+
+  if (monitor.canvas && gROOT->GetListOfCanvases()->FindObject(monitor.canvas)){
+    c = monitor.canvas;  // kept alive by Refresh, reused like a pooled canvas
+    c->Clear("D");
+    pooled = kTRUE;
+  }
+  else if (pooling){
+
+    std::string key = Form("%s:%d:%d:%s", title.Data(), w, h, layout.Data());
+    TCanvas*& pooledCanvas = canvasPool[key];
+
+    if (pooledCanvas && !gROOT->GetListOfCanvases()->FindObject(pooledCanvas)) pooledCanvas = nullptr;  // closed in the meantime
+
+    if (pooledCanvas){
+      pooledCanvas->Clear("D");  // clears the pads, but keeps them
+    }
+    else pooledCanvas = new TCanvas(Form("canvas%d", (Int_t)canvasPool.size()), title, x, y, w, h);
+
+    c = pooledCanvas;
+
+  }
+  else c = new TCanvas("canvas", title, x, y, w, h);
+
+  c->cd();
+  return c;
+
+}
+
+TPad* Plot::AcquirePad(const char* name, const char* title, Double_t x1, Double_t y1, Double_t x2, Double_t y2){
+
+  /** Returns the pad \p name of the current canvas, which is created and drawn
+      onto the canvas unless it is reused from the pool **/
+
+  TPad* pad = pooled ? dynamic_cast<TPad*>(canvas->GetPrimitive(name)) : nullptr;
+
+  if (pad){
+    pad->SetPad(x1, y1, x2, y2);
+    pad->SetLogx(0);
+    pad->SetLogy(0);
+    pad->SetLogz(0);
+    return pad;
+  }
+
+  pad = new TPad(name, title, x1, y1, x2, y2);
+  pad->Draw();
+
+  return pad;
+
+}
+
 void Plot::DrawArray(TObjArray* array, Int_t off, Int_t offOpt){
 
   /** Draws a single TObjArray in the chosen Pad **/
@@ -598,16 +1518,201 @@ void Plot::DrawArray(TObjArray* array, Int_t off, Int_t offOpt){
       continue;
     }
 
-    if ((plot == 0) && array->At(plot)->InheritsFrom("TF1")) opt = TString(options[plot+offOpt]).ReplaceAll("SAME","").Data();
-    else if (array->At(plot)->InheritsFrom("TGraph")) opt = TString(options[plot+offOpt]).ReplaceAll("SAME","").Data();
-    else opt = options[plot+offOpt].data();
+    if ((plot == 0) && array->At(plot)->InheritsFrom("TF1")) opt = TString((*options)[plot+offOpt]).ReplaceAll("SAME","").Data();
+    else if (array->At(plot)->InheritsFrom("TGraph")) opt = TString((*options)[plot+offOpt]).ReplaceAll("SAME","").Data();
+    else opt = (*options)[plot+offOpt].data();
 
     std::cout << " -> Draw " << array->At(plot)->ClassName() << ": "
               << array->At(plot)->GetName() << " as " << opt << std::endl;
 
     SetProperties(array->At(plot), plot + off);
+
+    if (plot > 0 && FunctionSampler::IsEnabled() && array->At(plot)->InheritsFrom("TF1")){
+      TString graphOpt = TString(opt).ReplaceAll("SAME","");
+      if (!graphOpt.Contains("L") && !graphOpt.Contains("C")) graphOpt += "L";
+      FunctionSampler::Sample((TF1*)array->At(plot), gPad->GetLogx())->Draw(graphOpt);
+      continue;
+    }
+
     array->At(plot)->Draw(opt.data());
 
   }
 
 }
+
+void Plot::PlaceLegends(TObjArray* array, TPad* pad, Float_t yLow, Float_t yUp){
+
+  /** Places all legends in \p array that were flagged via Legend::SetPositionAuto
+      in the emptiest region of the frame of \p pad. Legends flagged via
+      Legend::SetLayoutAuto are sized to their entries first (cf. LayoutLegends). **/
+
+  OccupancyGrid grid(pad->GetLeftMargin(), 1 - pad->GetRightMargin(), pad->GetBottomMargin(), 1 - pad->GetTopMargin());
+  grid.SetRanges(xRangeLow, xRangeUp, yLow, yUp, pad->GetLogx(), pad->GetLogy());
+
+  TIter iPrimitives(pad->GetListOfPrimitives());
+  while (TObject* obj = iPrimitives()){
+    if (obj->InheritsFrom("TLine")) grid.Fill(obj);  // lines drawn directly onto the pad
+  }
+
+  LayoutLegends(array, grid, pad->GetWw()*pad->GetAbsWNDC(), pad->GetWh()*pad->GetAbsHNDC());
+
+}
+
+void Plot::LayoutLegends(TObjArray* array, OccupancyGrid& grid, UInt_t padWidth, UInt_t padHeight, std::vector<std::string>* problems){
+
+  /** Sizes the legends in \p array flagged via Legend::SetLayoutAuto and places
+      those flagged via Legend::SetPositionAuto in the emptiest region of \p grid.
+      The drawn objects and all other legends are rasterized into the grid, each
+      placed legend is added to the grid before the next one is placed.
+      If \p problems is given, legends that do not fit are reported there
+      instead of being printed and all legends are left unchanged (dry run):
+      their layout is only fitted to check the placement and restored afterwards. **/
+
+  //! Geometry of a legend before a dry run
+  struct Geometry {
+    TLegend* legend;
+    Double_t x1, y1, x2, y2;
+    Int_t nColumns;
+  };
+  std::vector<Geometry> saved;
+
+  auto restore = [&](){
+    for (const Geometry& geometry : saved){
+      geometry.legend->SetX1(geometry.x1);
+      geometry.legend->SetY1(geometry.y1);
+      geometry.legend->SetX2(geometry.x2);
+      geometry.legend->SetY2(geometry.y2);
+      geometry.legend->SetNColumns(geometry.nColumns);
+    }
+  };
+
+  std::vector<TLegend*> autoLegends;
+
+  TIter iArray(array);
+  while (TObject* obj = iArray()){
+    if (!obj->InheritsFrom("TLegend")) continue;
+    TLegend* legend = (TLegend*)obj;
+    if (legend->TestBit(kLayoutAuto)){
+      if (problems) saved.push_back({legend, legend->GetX1(), legend->GetY1(), legend->GetX2(), legend->GetY2(), legend->GetNColumns()});
+      FitLegendLayout(legend, padWidth, padHeight, 0.9*grid.GetFrameWidth(), 0.5*grid.GetFrameHeight());
+    }
+    if (legend->TestBit(kPositionAuto)) autoLegends.push_back(legend);
+  }
+
+  if (autoLegends.empty()){
+    restore();
+    return;
+  }
+
+  iArray.Reset();
+  while (TObject* obj = iArray()){
+    if (!obj->TestBit(kPositionAuto)) grid.Fill(obj);
+  }
+
+  for (TLegend* legend : autoLegends){
+
+    Double_t w = legend->GetX2() - legend->GetX1();
+    Double_t h = legend->GetY2() - legend->GetY1();
+    Double_t x1, y1;
+
+    if (!grid.FindEmptiest(w, h, x1, y1)){
+      if (problems) problems->push_back(std::string("Legend ") + legend->GetName() + " does not fit into the frame");
+      else std::cout << "\033[1;31mERROR in PlaceLegends:\033[0m Legend " << legend->GetName() << " does not fit into the frame! Position not changed." << std::endl;
+      continue;
+    }
+
+    if (!problems){
+      legend->SetX1(x1);
+      legend->SetX2(x1 + w);
+      legend->SetY1(y1);
+      legend->SetY2(y1 + h);
+    }
+    grid.FillBox(x1, y1, x1 + w, y1 + h, 1E9);
+
+  }
+
+  restore();
+
+}
+
+TAxis* Plot::GetAxis(TObject* first, Int_t axis){
+
+  /** Returns X (\p axis = 0) or Y (\p axis = 1) axis of the first object of an array **/
+
+  if (first->InheritsFrom("TH1"))         return axis ? ((TH1*)first)->GetYaxis() : ((TH1*)first)->GetXaxis();
+  if (first->InheritsFrom("TF1"))         return axis ? ((TF1*)first)->GetYaxis() : ((TF1*)first)->GetXaxis();
+  if (first->InheritsFrom("TMultiGraph")) return axis ? ((TMultiGraph*)first)->GetYaxis() : ((TMultiGraph*)first)->GetXaxis();
+
+  return nullptr;
+
+}
+
+std::vector<std::string> Plot::GetAxisLabels(Float_t low, Float_t up, Bool_t log, Int_t nDivisions){
+
+  /** Estimate the labels of an axis from \p low to \p up with \p nDivisions divisions,
+      only used to determine the space needed by the labels **/
+
+  std::vector<std::string> labels;
+
+  if (log && low > 0 && up > low){
+    for (Int_t exp = TMath::Floor(TMath::Log10(low)); exp <= TMath::Ceil(TMath::Log10(up)); exp++){
+      if (exp >= 0 && exp <= 2) labels.push_back(std::to_string((Int_t)TMath::Power(10, exp)));
+      else labels.push_back("10^{" + std::to_string(exp) + "}");
+    }
+    return labels;
+  }
+
+  Int_t primary = std::max(nDivisions%100, 1);
+  Double_t raw  = TMath::Abs(up - low)/primary;
+  if (!(raw > 0)) return {TString::Format("%g", low).Data()};
+
+  Double_t magnitude = TMath::Power(10, TMath::Floor(TMath::Log10(raw)));
+  Double_t step = magnitude*((raw <= magnitude) ? 1 : (raw <= 2*magnitude) ? 2 : (raw <= 5*magnitude) ? 5 : 10);
+
+  for (Double_t tick = TMath::Ceil(std::min(low, up)/step); tick*step <= std::max(low, up) + 1E-9*step; tick++){
+    labels.push_back(TString::Format("%g", tick*step).Data());
+  }
+
+  return labels;
+
+}
+
+void Plot::FitMargins(TPad* pad, TObject* first, Float_t yLow, Float_t yUp, Bool_t xAxis){
+
+  /** Fit the margins of \p pad and the title offsets of the axes of \p first to the
+      space needed by the axis labels and titles. All text extents are taken from
+      the TextMetrics cache, so no iterative painting is needed.
+      The X-axis is only fitted if \p xAxis is true. **/
+
+  TAxis* axisX = GetAxis(first, 0);
+  TAxis* axisY = GetAxis(first, 1);
+  if (!axisX || !axisY) return;
+
+  UInt_t padWidth  = pad->GetWw()*pad->GetAbsWNDC();
+  UInt_t padHeight = pad->GetWh()*pad->GetAbsHNDC();
+  if (!padWidth || !padHeight) return;
+
+  Float_t size = TextMetrics::GetPixelSize(font, label, padWidth, padHeight);
+  Float_t gap  = 0.5*size;
+
+  UInt_t widest = 0;
+  for (const std::string& text : GetAxisLabels(yLow, yUp, pad->GetLogy(), axisY->GetNdivisions())){
+    widest = std::max(widest, TextMetrics::GetTextWidth(text, font, size));
+  }
+
+  UInt_t titleY = TextMetrics::GetTextHeight(axisY->GetTitle(), font, size);
+  Float_t distanceY = axisY->GetLabelOffset()*padWidth + widest + gap + titleY;
+
+  axisY->SetTitleOffset(distanceY/(1.6*size));
+  pad->SetLeftMargin((distanceY + gap)/padWidth);
+
+  if (!xAxis) return;
+
+  UInt_t labelX = TextMetrics::GetTextHeight("0123456789", font, size);
+  UInt_t titleX = TextMetrics::GetTextHeight(axisX->GetTitle(), font, size);
+  Float_t distanceX = axisX->GetLabelOffset()*padHeight + labelX + gap;
+
+  axisX->SetTitleOffset(distanceX/(1.6*size));
+  pad->SetBottomMargin((distanceX + titleX + gap)/padHeight);
+
+}
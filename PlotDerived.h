@@ -12,7 +12,12 @@
 //                     distributions while the lower pad is for the
 //                     corresponding ratios
 //  - HeatMapPlot: Simple Plot in Square format for drawing one TH2 (heatmap)
-//                 and one corresponding legend
+//                 and one corresponding legend, can also be exported as
+//                 tile pyramid for very large maps
+//  - TimeSeriesPlot: Rectangle Plot showing a rolling time window of series
+//                    that are kept in fixed-size ring buffers
+//  - StackPlot: SingleRatioPlot of stacked contributions with the uncertainty
+//               of their total, compared to data in the ratio pad
 //
 // ----------------------------------------------------------------------------
 
@@ -32,7 +37,18 @@ public:
   SquarePlot(TObjArray* array, TString xTitle, TString yTitle);
   virtual ~SquarePlot() {}
 
+  void Rebind(TObjArray* array);
+
+  using Plot::Draw;
+  using Plot::Validate;
   /*virtual*/ void Draw(TString outname);
+  virtual void BuildCanvas();
+  virtual Bool_t Validate(std::vector<std::string>& problems);
+
+protected:
+
+  virtual TObjArray* GetRasterArray() {return plotArray;} //!< Array painted by the raster backend
+  virtual std::vector<std::pair<TPad*, TObjArray*>> GetPadArrays() {return {{mainPad, plotArray}};} //!< Pads and their arrays, for Refresh
 
 private:
 
@@ -59,6 +75,20 @@ SquarePlot::SquarePlot(TObjArray* array, TString xTitle, TString yTitle): Plot(x
 
 // ---- Member Functions ------------------------------------------------------
 
+void SquarePlot::Rebind(TObjArray* array){
+
+  /** Replaces the objects to be plotted by \p array, keeping all other settings,
+      so that one configured plot can be drawn for many inputs. The options are
+      only copied if the number of objects changed. **/
+
+  plotArray = array;
+  broken = kFALSE;
+  EnsureAxes(array->At(0), "Main Array");
+
+  if ((Int_t)options->size() != array->GetEntries()) options.Write().resize(array->GetEntries(), "SAME");
+
+}
+
 void SquarePlot::Draw(TString outname){
 
   /** Main function for Drawing **/
@@ -73,22 +103,55 @@ void SquarePlot::Draw(TString outname){
     return;
   }
 
-  canvas  = new TCanvas("canvas", "SQUARE", 10, 10, width+10, height+10);
-  canvas->cd();
+  if (!rasterBackend || !outname.EndsWith(".png") || !DrawRaster(plotArray, outname)){
+    BuildCanvas();
+    canvas->SaveAs(outname.Data());
+    ReleaseCanvas();
+  }
+
+  std::cout << "-----------------------------" << std::endl << std::endl;
+
+}
+
+void SquarePlot::BuildCanvas(){
+
+  /** Sets up the canvas with all pads and objects without saving it **/
 
-  mainPad = new TPad("mainPad", "Distribution", 0, 0, 1, 1);
+  canvas  = AcquireCanvas("SQUARE", 10, 10, width+10, height+10);
+
+  mainPad = AcquirePad("mainPad", "Distribution", 0, 0, 1, 1);
   SetUpPad(mainPad, logX, logY);
   SetUpStyle(plotArray->At(0), titleX, titleY, xRangeUp, xRangeLow, yRangeUp, yRangeLow, offsetX, offsetY);
-  mainPad->Draw();
+  if (marginsAuto) FitMargins(mainPad, plotArray->At(0), yRangeLow, yRangeUp);
   mainPad->cd();
 
   DrawArray(plotArray, mOffset);
+  PlaceLegends(plotArray, mainPad, yRangeLow, yRangeUp);
 
   canvas->Update();
-  canvas->SaveAs(outname.Data());
-  delete canvas;
 
-  std::cout << "-----------------------------" << std::endl << std::endl;
+}
+
+Bool_t SquarePlot::Validate(std::vector<std::string>& problems){
+
+  /** Dry run of Draw: checks the array, draw options, ranges, logarithmic axes
+      and legend layout without drawing anything **/
+
+  size_t nProblems = problems.size();
+  Plot::Validate(problems);
+
+  if (ValidateArray(plotArray, "Main Array", 0, problems)){
+
+    Float_t xLow = xRangeLow, xUp = xRangeUp, yLow = yRangeLow, yUp = yRangeUp;
+    if (!ranges) ValidateRangesAuto(plotArray->At(0), xLow, xUp, yLow, yUp, problems);
+
+    ValidateLog(logX, xRangeLow, "X", problems);
+    ValidateLog(logY, yRangeLow, "Y", problems);
+    ValidateFrame(plotArray, "Main Array", width, height, bottomMargin, topMargin, xLow, xUp, yLow, yUp, logY, problems);
+
+  }
+
+  return problems.size() == nProblems;
 
 }
 
@@ -106,13 +169,23 @@ public:
   RatioPlot(TObjArray* rArray, TString xTitle, TString yTitle);
   virtual ~RatioPlot() {};
 
+  void Rebind(TObjArray* rArray);
+
+  using Plot::Draw;
+  using Plot::Validate;
   /*virtual*/ void Draw(TString outname);
+  virtual void BuildCanvas();
+  virtual Bool_t Validate(std::vector<std::string>& problems);
   /*virtual*/ void DrawRatioArray(TObjArray* array, Int_t off, Int_t offOpt = 0);
   void SetUpperOneLimit(Double_t up);
   void ToggleOne() {drawone = !drawone;}  //!< Toggle wether TLine indicating ratio = 1, will be drawn
 
 protected:
 
+  virtual TObjArray* GetRasterArray() {return plotArray;} //!< Array painted by the raster backend
+  virtual void RasterLines(std::vector<TLine>& lines);
+  virtual std::vector<std::pair<TPad*, TObjArray*>> GetPadArrays() {return {{mainPad, plotArray}};} //!< Pads and their arrays, for Refresh
+
   TObjArray* plotArray;      //!< Array containing all objects to be plotted
 
   TLine*   one {nullptr};    //!< Horizontal TLine which will be included to every ratio at height 1
@@ -141,6 +214,19 @@ RatioPlot::RatioPlot(TObjArray* rArray, TString xTitle, TString yTitle) : Plot(x
 
 // ---- Member Functions ------------------------------------------------------
 
+void RatioPlot::Rebind(TObjArray* rArray){
+
+  /** Replaces the objects to be plotted by \p rArray, keeping all other settings.
+      The options are only copied if the number of objects changed. **/
+
+  plotArray = rArray;
+  broken = kFALSE;
+  EnsureAxes(rArray->At(0), "Main Array");
+
+  if ((Int_t)options->size() != rArray->GetEntries()) options.Write().resize(rArray->GetEntries(), "SAME");
+
+}
+
 void RatioPlot::Draw(TString outname){
 
   /** Main function for Drawing **/
@@ -155,22 +241,55 @@ void RatioPlot::Draw(TString outname){
     return;
   }
 
-  canvas  = new TCanvas("canvas", "RATIO", /*10*/0, /*10*/0, width/*+10*/, height/*+10*/);
-  canvas->cd();
+  if (!rasterBackend || !outname.EndsWith(".png") || !DrawRaster(plotArray, outname)){
+    BuildCanvas();
+    canvas->SaveAs(outname.Data());
+    ReleaseCanvas();
+  }
 
-  mainPad = new TPad("mainPad", "Ratio", 0, 0, 1, 1);
+  std::cout << "-----------------------------" << std::endl << std::endl;
+
+}
+
+void RatioPlot::BuildCanvas(){
+
+  /** Sets up the canvas with all pads and objects without saving it **/
+
+  canvas  = AcquireCanvas("RATIO", /*10*/0, /*10*/0, width/*+10*/, height/*+10*/);
+
+  mainPad = AcquirePad("mainPad", "Ratio", 0, 0, 1, 1);
   SetUpPad(mainPad, logX, logY);
   SetUpStyle(plotArray->At(0), titleX, titleY, xRangeUp, xRangeLow, yRangeUp, yRangeLow, offsetX, offsetY);
-  mainPad->Draw();
+  if (marginsAuto) FitMargins(mainPad, plotArray->At(0), yRangeLow, yRangeUp);
   mainPad->cd();
 
   DrawRatioArray(plotArray, mOffset);
+  PlaceLegends(plotArray, mainPad, yRangeLow, yRangeUp);
 
   canvas->Update();
-  canvas->SaveAs(outname.Data());
-  delete canvas;
 
-  std::cout << "-----------------------------" << std::endl << std::endl;
+}
+
+Bool_t RatioPlot::Validate(std::vector<std::string>& problems){
+
+  /** Dry run of Draw: checks the array, draw options, ranges, logarithmic axes
+      and legend layout without drawing anything **/
+
+  size_t nProblems = problems.size();
+  Plot::Validate(problems);
+
+  if (ValidateArray(plotArray, "Main Array", 0, problems)){
+
+    Float_t xLow = xRangeLow, xUp = xRangeUp, yLow = yRangeLow, yUp = yRangeUp;
+    if (!ranges) ValidateRangesAuto(plotArray->At(0), xLow, xUp, yLow, yUp, problems);
+
+    ValidateLog(logX, xRangeLow, "X", problems);
+    ValidateLog(logY, yRangeLow, "Y", problems);
+    ValidateFrame(plotArray, "Main Array", width, height, bottomMargin, topMargin, xLow, xUp, yLow, yUp, logY, problems);
+
+  }
+
+  return problems.size() == nProblems;
 
 }
 
@@ -178,15 +297,26 @@ void RatioPlot::DrawRatioArray(TObjArray* array, Int_t off, Int_t offOpt){
 
   /** Draws a single Ratio TObjArray in the chosen Pad **/
 
+  DrawArray(array, off, offOpt);
+
   if (drawone){
     one = new TLine(xRangeLow, 1., (oneUp ? oneUp : xRangeUp), 1.);
-    array->Add(one);
-    options.push_back("SAME");
+    one->SetBit(TObject::kCanDelete);
     SetLineProperties(one, kBlack, 9, 3.);
+    one->Draw("SAME");
   }
 
-  DrawArray(array, off, offOpt);
 
+}
+
+void RatioPlot::RasterLines(std::vector<TLine>& lines){
+
+  /** Adds the line at ratio one for the raster backend, cf. DrawRatioArray **/
+
+  if (!drawone) return;
+
+  lines.emplace_back(xRangeLow, 1., (oneUp ? oneUp : xRangeUp), 1.);
+  SetLineProperties(&lines.back(), kBlack, 9, 3.);
 
 }
 
@@ -212,7 +342,14 @@ public:
   SingleRatioPlot(TObjArray* mainArray, TObjArray* ratioArray, TString xTitle, TString yTitle, TString ratioTitle);
   virtual ~SingleRatioPlot() {};
 
+  void Rebind(TObjArray* mainArray, TObjArray* rArray);
+
+  using Plot::Draw;
+  using Plot::Validate;
   /*virtual*/ void Draw(TString outname);
+  virtual void BuildCanvas();
+  virtual void ReleaseCanvas();
+  virtual Bool_t Validate(std::vector<std::string>& problems);
 
   void SetPadFraction(Double_t frac);
   void SetCanvasOffsets(Float_t xOffset, Float_t yOffset, Float_t rOffset = 0);
@@ -220,14 +357,20 @@ public:
   virtual void SetRanges(Float_t xLow, Float_t xUp, Float_t yLow, Float_t yUp, Float_t rLow, Float_t rUp);
   virtual void SetOptions(std::string optns, std::string postns);
 
+protected:
+
+  virtual TObjArray* GetRasterArray() {return nullptr;} //!< Two pads are not supported by the raster backend
+  virtual std::vector<std::pair<TPad*, TObjArray*>> GetPadArrays() {return {{mainPad, plotArray}, {ratioPad, ratioArray}};} //!< Pads and their arrays, for Refresh
+
+  TObjArray* ratioArray;         //!< Array containing all ratios to be plotted
+
 private:
 
   static Float_t padFrac;        //!< Fraction of the Canvas used for the ratio pad
 
   TPad* ratioPad {nullptr};      //!< Pad containing the ratio plot
   TString ratioTitle;            //!< Title for Y-axis of Ratios
-
-  TObjArray* ratioArray;         //!< Array containing all ratios to be plotted
+  Int_t nMainObjects {0};        //!< Number of main objects, i.e. options belonging to the upper pad
 
   Float_t offsetR {0.};          //!< Offset for Y-Title of the ratio
   Float_t rRangeUp {1.2};        //!< Upper Y-axis range of the ratio
@@ -246,8 +389,8 @@ Int_t   SingleRatioPlot::rOffset  {1};
 
 //! Constructor
 SingleRatioPlot::SingleRatioPlot(TObjArray* mainArray, TObjArray* rArray, TString xTitle, TString yTitle, TString rTitle) : RatioPlot(mainArray, xTitle, yTitle),
-  ratioTitle(rTitle),
-  ratioArray(rArray)
+  ratioArray(rArray),
+  ratioTitle(rTitle)
 {
 
   EnsureAxes(mainArray->At(0), "Main Array");
@@ -257,12 +400,47 @@ SingleRatioPlot::SingleRatioPlot(TObjArray* mainArray, TObjArray* rArray, TStrin
   SetCanvasMargins(0.13, 0.03, 0.05, 0.3);
   SetCanvasOffsets(4., 2., 2.);
 
+  nMainObjects = mainArray->GetEntries();
   options = std::vector<std::string>(mainArray->GetEntries()+rArray->GetEntries(), "SAME");
 
 }
 
 // ---- Member Functions ------------------------------------------------------
 
+void SingleRatioPlot::Rebind(TObjArray* mainArray, TObjArray* rArray){
+
+  /** Replaces the distributions by \p mainArray and the ratios by \p rArray,
+      keeping all other settings. The options are only copied if the number
+      of objects changed, the options of the ratios stay with the ratios.
+      The previous arrays are not accessed, they may already be deleted. **/
+
+  if (!mainArray || !rArray){
+    std::cout << "\033[1;31mERROR:\033[0m Main or ratio array is missing! Plot will not be drawn." << std::endl;
+    broken = kTRUE;
+    return;
+  }
+
+  Int_t nMain  = mainArray->GetEntries();
+  Int_t nRatio = rArray->GetEntries();
+  Int_t oldMain  = std::min(nMainObjects, (Int_t)options->size());
+  Int_t oldRatio = options->size() - oldMain;
+
+  plotArray  = mainArray;
+  ratioArray = rArray;
+  nMainObjects = nMain;
+  broken = kFALSE;
+  EnsureAxes(mainArray->At(0), "Main Array");
+  EnsureAxes(rArray->At(0), "Ratio Array");
+
+  if (nMain == oldMain && nRatio == oldRatio) return;
+
+  std::vector<std::string> opts(nMain + nRatio, "SAME");
+  std::copy_n(options->begin(), std::min(nMain, oldMain), opts.begin());
+  std::copy_n(options->begin() + oldMain, std::min(nRatio, oldRatio), opts.begin() + nMain);
+  options = std::move(opts);
+
+}
+
 void SingleRatioPlot::Draw(TString outname){
 
   /** Main function for Drawing **/
@@ -277,32 +455,84 @@ void SingleRatioPlot::Draw(TString outname){
     return;
   }
 
-  canvas  = new TCanvas("canvas", "SINGLE RATIO", 10, 10, width+10, height+10);
-  canvas->cd();
+  BuildCanvas();
+  canvas->SaveAs(outname.Data());
+  ReleaseCanvas();
+
+  std::cout << "-----------------------------" << std::endl << std::endl;
+
+}
+
+void SingleRatioPlot::BuildCanvas(){
 
-  mainPad = new TPad("mainPad", "Distribution", 0, padFrac, 1, 1);
+  /** Sets up the canvas with all pads and objects without saving it **/
+
+  canvas  = AcquireCanvas("SINGLE RATIO", 10, 10, width+10, height+10, Form("%g", padFrac));
+
+  mainPad = AcquirePad("mainPad", "Distribution", 0, padFrac, 1, 1);
   SetUpPad(mainPad, logX, logY);
   SetUpStyle(plotArray->At(0), "", titleY, xRangeUp, xRangeLow, yRangeUp, yRangeLow, offsetX, offsetY);
   SuppressXaxis(plotArray->At(0));
   mainPad->SetBottomMargin(0.);
-  mainPad->Draw();
 
-  ratioPad = new TPad("ratioPad", "Ratio", 0, 0, 1, padFrac);
+  ratioPad = AcquirePad("ratioPad", "Ratio", 0, 0, 1, padFrac);
   SetUpPad(ratioPad, logX, kFALSE);
   ratioPad->SetTopMargin(0.);
   SetUpStyle(ratioArray->At(0), titleX, ratioTitle, xRangeUp, xRangeLow, rRangeUp, rRangeLow, offsetX, offsetR);
-  ratioPad->Draw();
+  if (marginsAuto){
+    FitMargins(mainPad, plotArray->At(0), yRangeLow, yRangeUp, kFALSE);
+    FitMargins(ratioPad, ratioArray->At(0), rRangeLow, rRangeUp);
+    mainPad->SetLeftMargin(std::max(mainPad->GetLeftMargin(), ratioPad->GetLeftMargin()));
+    ratioPad->SetLeftMargin(mainPad->GetLeftMargin());
+  }
 
   mainPad->cd();
   DrawArray(plotArray, mOffset);
+  PlaceLegends(plotArray, mainPad, yRangeLow, yRangeUp);
   ratioPad->cd();
   DrawRatioArray(ratioArray, rOffset, plotArray->GetEntries());
+  PlaceLegends(ratioArray, ratioPad, rRangeLow, rRangeUp);
 
   canvas->Update();
-  canvas->SaveAs(outname.Data());
-  delete canvas;
 
-  std::cout << "-----------------------------" << std::endl << std::endl;
+}
+
+void SingleRatioPlot::ReleaseCanvas(){
+
+  /** Releases the canvas like Plot::ReleaseCanvas and forgets the ratio pad,
+      which is deleted or pooled together with the canvas **/
+
+  Plot::ReleaseCanvas();
+  ratioPad = nullptr;
+
+}
+
+Bool_t SingleRatioPlot::Validate(std::vector<std::string>& problems){
+
+  /** Dry run of Draw: checks both arrays, their draw options, ranges,
+      logarithmic axes and legend layout of both pads without drawing anything **/
+
+  size_t nProblems = problems.size();
+  Plot::Validate(problems);
+
+  Bool_t mainValid  = ValidateArray(plotArray, "Main Array", 0, problems);
+  Bool_t ratioValid = ValidateArray(ratioArray, "Ratio Array", plotArray ? plotArray->GetEntries() : 0, problems);
+
+  if (padFrac <= 0 || padFrac >= 1) problems.push_back(Form("Pad fraction %g is not between 0 and 1", padFrac));
+
+  if (mainValid){
+
+    Float_t xLow = xRangeLow, xUp = xRangeUp, yLow = yRangeLow, yUp = yRangeUp;
+    if (!ranges) ValidateRangesAuto(plotArray->At(0), xLow, xUp, yLow, yUp, problems);
+
+    ValidateLog(logX, xRangeLow, "X", problems);
+    ValidateLog(logY, yRangeLow, "Y", problems);
+    ValidateFrame(plotArray, "Main Array", width, height*(1 - padFrac), 0, topMargin, xLow, xUp, yLow, yUp, logY, problems);
+    if (ratioValid) ValidateFrame(ratioArray, "Ratio Array", width, height*padFrac, bottomMargin, 0, xLow, xUp, rRangeLow, rRangeUp, kFALSE, problems);
+
+  }
+
+  return problems.size() == nProblems;
 
 }
 
@@ -386,17 +616,40 @@ public:
   HeatMapPlot(TH2* map, TLegend* l, TString xTitle, TString yTitle, TString zTitle = "count");
   ~HeatMapPlot() {};
 
+  void Rebind(TObjArray* array);
+
+  using Plot::Draw;
+  using Plot::Validate;
   void Draw(TString outname);
+  virtual void BuildCanvas();
+  virtual Bool_t Validate(std::vector<std::string>& problems);
+  Bool_t ExportTiles(TString directory, UInt_t tileSize = 256, Int_t nThreads = 0);
 
   void SetProperties(TH2* map, std::string title = "");
   void SetCanvasOffsets(Float_t xOffset, Float_t yOffset, Float_t zOffset);
   /*virtual*/ void SetLog(Bool_t xLog = kFALSE, Bool_t yLog = kTRUE, Bool_t zLog = kFALSE);
   virtual void SetRanges(Float_t xLow, Float_t xUp, Float_t yLow, Float_t yUp, Float_t zLow, Float_t zUp);
 
+protected:
+
+  virtual std::vector<std::pair<TPad*, TObjArray*>> GetPadArrays() {return {{mainPad, plotArray}};} //!< Pads and their arrays, for Refresh
 
 private:
 
+  //! One zoom level of a tile pyramid, cells are counted from the upper left corner
+  struct TileLevel {
+    UInt_t nx {0};                   //!< Number of columns
+    UInt_t ny {0};                   //!< Number of rows
+    TH2*   map {nullptr};            //!< Heatmap read directly at full resolution, instead of the vectors
+    std::vector<Float_t> values;     //!< Mean of the filled bins covered by each cell
+    std::vector<Float_t> weights;    //!< Number of filled bins covered by each cell
+
+    Float_t Get(UInt_t col, UInt_t row, Float_t& weight) const;
+  };
+
   void EnsureTH2(TObject* first, std::string arrayName);
+  static TileLevel ReduceLevel(const TileLevel& level, Int_t nThreads);
+  void WriteTiles(const TileLevel& level, TString directory, UInt_t tileSize, const std::vector<UInt_t>& levelColors, Float_t zLow, Float_t zUp, Bool_t zLog, Int_t nThreads);
 
   void SetCanvasStyle(TH2* first);
   void SetPadStyle(TH2* first, TString xTitle, TString yTitle, TString zTitle, Float_t xUp, Float_t xLow, Float_t yUp, Float_t yLow, Float_t zUp, Float_t zLow);
@@ -429,7 +682,7 @@ plotArray(array)
   SetCanvasOffsets(1.3, 1.4, 1.4);
 
   options = std::vector<std::string>(array->GetEntries(), "SAME");
-  options[0] = "SAME COLZ";
+  options.Write()[0] = "SAME COLZ";
 
 }
 
@@ -453,6 +706,19 @@ titleZ(zTitle)
 
 // ---- Member Functions ------------------------------------------------------
 
+void HeatMapPlot::Rebind(TObjArray* array){
+
+  /** Replaces the heatmap and its legends by \p array, keeping all other settings.
+      The options are only copied if the number of objects changed. **/
+
+  plotArray = array;
+  broken = kFALSE;
+  EnsureTH2(array->At(0), "Heatmap Array");
+
+  if ((Int_t)options->size() != array->GetEntries()) options.Write().resize(array->GetEntries(), "SAME");
+
+}
+
 void HeatMapPlot::Draw(TString outname){
 
   /** Main function for Drawing **/
@@ -467,23 +733,58 @@ void HeatMapPlot::Draw(TString outname){
     return;
   }
 
-  canvas  = new TCanvas("canvas", "HEATMAP", 10, 10, width+10, height+10);
-  canvas->cd();
+  BuildCanvas();
+  canvas->SaveAs(outname.Data());
+  ReleaseCanvas();
+
+  std::cout << "-----------------------------" << std::endl << std::endl;
+
+}
+
+void HeatMapPlot::BuildCanvas(){
 
-  mainPad = new TPad("mainPad", "Distribution", 0, 0, 1, 1);
+  /** Sets up the canvas with all pads and objects without saving it **/
+
+  canvas  = AcquireCanvas("HEATMAP", 10, 10, width+10, height+10);
+
+  mainPad = AcquirePad("mainPad", "Distribution", 0, 0, 1, 1);
   SetUpPad(mainPad, logX, logY, logZ);
   SetCanvasStyle((TH2*)plotArray->At(0));
   SetPadStyle((TH2*)plotArray->At(0), titleX, titleY, titleZ, xRangeUp, xRangeLow, yRangeUp, yRangeLow, zRangeUp, zRangeLow);
-  mainPad->Draw();
+  if (marginsAuto) FitMargins(mainPad, plotArray->At(0), yRangeLow, yRangeUp);
   mainPad->cd();
 
   DrawArray(plotArray, 0);
+  PlaceLegends(plotArray, mainPad, yRangeLow, yRangeUp);
 
   canvas->Update();
-  canvas->SaveAs(outname.Data());
-  delete canvas;
 
-  std::cout << "-----------------------------" << std::endl << std::endl;
+}
+
+Bool_t HeatMapPlot::Validate(std::vector<std::string>& problems){
+
+  /** Dry run of Draw: checks the heatmap, draw options, ranges, logarithmic
+      axes and legend layout without drawing anything **/
+
+  size_t nProblems = problems.size();
+  Plot::Validate(problems);
+
+  if (ValidateArray(plotArray, "Heatmap Array", 0, problems, kFALSE)){
+
+    if (!plotArray->At(0)->InheritsFrom("TH2")){
+      problems.push_back(std::string("Heatmap Array: first entry must be a TH2, but is a ") + plotArray->At(0)->ClassName());
+    }
+    else {
+      if (!(zRangeLow < zRangeUp)) problems.push_back(Form("Heatmap Array: Z-range [%g, %g] is empty", zRangeLow, zRangeUp));
+      ValidateLog(logX, xRangeLow, "X", problems);
+      ValidateLog(logY, yRangeLow, "Y", problems);
+      ValidateLog(logZ, zRangeLow, "Z", problems);
+      ValidateFrame(plotArray, "Heatmap Array", width, height, bottomMargin, topMargin, xRangeLow, xRangeUp, yRangeLow, yRangeUp, logY, problems);
+    }
+
+  }
+
+  return problems.size() == nProblems;
 
 }
 
@@ -509,6 +810,173 @@ void HeatMapPlot::EnsureTH2(TObject* first, std::string arrayName){
 
 }
 
+Bool_t HeatMapPlot::ExportTiles(TString directory, UInt_t tileSize, Int_t nThreads){
+
+  /** Exports the heatmap as tile pyramid for map viewers: every zoom level is
+      cut into PNG tiles of \p tileSize x \p tileSize pixels, written to
+      <directory>/<zoom>/<column>/<row>.png. Zoom level 0 is a single tile, the
+      highest level shows one bin per pixel, each level is built from the next
+      finer one by averaging 2x2 cells. Bins are colored with the active palette
+      within the Z-range (the range of the heatmap if none was set), empty bins
+      and bins below the range stay transparent. The layout of the pyramid is
+      written to <directory>/tiles.json.
+      Levels are built one after the other, so besides the heatmap itself at
+      most a quarter of it is held in memory; the cells of each level and its
+      tiles are processed on \p nThreads threads (all if 0). **/
+
+  std::cout << "-----------------------------" << std::endl;
+  std::cout << "     Export Heat Map Tiles:" << std::endl;
+  std::cout << "-----------------------------" << std::endl;
+
+  if (broken || !tileSize){
+    std::cout << "Due to one or more \033[1;33mFATAL ERRORS\033[0m your Plot will not be exported" << std::endl;
+    std::cout << "-----------------------------" << std::endl << std::endl;
+    return kFALSE;
+  }
+
+  TH2* map = (TH2*)plotArray->At(0);
+
+  TileLevel level;
+  level.map = map;
+  level.nx  = map->GetNbinsX();
+  level.ny  = map->GetNbinsY();
+
+  Int_t maxZoom = 0;
+  while ((std::max(level.nx, level.ny) - 1)/(tileSize << maxZoom) > 0) maxZoom++;
+
+  // Z-range and palette, with one color per contour level like the ROOT graphics
+  Float_t zLow = zRangeLow, zUp = zRangeUp;
+  if (!(zLow < zUp)){
+    zLow = logZ ? map->GetMinimum(0) : map->GetMinimum();
+    zUp  = map->GetMaximum();
+  }
+  Bool_t zLog = logZ && zLow > 0;
+  if (logZ && !zLog) std::cout << "\033[1;31mERROR in SetLog:\033[0m Z-Ranges must be above zero! Logarithm not set!!" << std::endl;
+  if (zLog){
+    zLow = TMath::Log10(zLow);
+    zUp  = TMath::Log10(zUp);
+  }
+  if (!(zLow < zUp)) zUp = zLow + 1;
+
+  SetUpPalette();
+  Int_t nColors = gStyle->GetNumberOfColors();
+  Int_t nLevels = std::max(gStyle->GetNumberContours(), 1);
+  std::vector<UInt_t> levelColors(nLevels);
+  for (Int_t contour = 0; contour < nLevels; contour++)
+    levelColors[contour] = RasterImage::GetColor(gStyle->GetColorPalette(std::min(Int_t((contour + 0.99)*nColors/nLevels), nColors - 1)));
+
+  for (Int_t zoom = maxZoom; zoom >= 0; zoom--){
+
+    if (zoom < maxZoom) level = ReduceLevel(level, nThreads);
+
+    std::cout << " -> Zoom level " << zoom << ": " << level.nx << " x " << level.ny << " cells" << std::endl;
+    WriteTiles(level, Form("%s/%d", directory.Data(), zoom), tileSize, levelColors, zLow, zUp, zLog, nThreads);
+
+  }
+
+  std::ofstream layout(Form("%s/tiles.json", directory.Data()));
+  layout << "{\"tileSize\": " << tileSize << ", \"minZoom\": 0, \"maxZoom\": " << maxZoom
+         << ", \"width\": " << map->GetNbinsX() << ", \"height\": " << map->GetNbinsY()
+         << ", \"xMin\": " << map->GetXaxis()->GetXmin() << ", \"xMax\": " << map->GetXaxis()->GetXmax()
+         << ", \"yMin\": " << map->GetYaxis()->GetXmin() << ", \"yMax\": " << map->GetYaxis()->GetXmax()
+         << ", \"zMin\": " << (zLog ? TMath::Power(10, zLow) : zLow) << ", \"zMax\": " << (zLog ? TMath::Power(10, zUp) : zUp)
+         << ", \"zLog\": " << (zLog ? "true" : "false") << "}" << std::endl;
+
+  std::cout << "Info: " << maxZoom + 1 << " zoom levels have been written to " << directory << std::endl;
+  std::cout << "-----------------------------" << std::endl << std::endl;
+
+  return layout.good();
+
+}
+
+Float_t HeatMapPlot::TileLevel::Get(UInt_t col, UInt_t row, Float_t& weight) const {
+
+  /** Returns the value of a cell and its weight (0 for empty cells) **/
+
+  if (map){
+    Float_t value = map->GetBinContent(col + 1, ny - row);
+    weight = (value != 0);
+    return value;
+  }
+
+  size_t cell = (size_t)row*nx + col;
+  weight = weights[cell];
+  return values[cell];
+
+}
+
+HeatMapPlot::TileLevel HeatMapPlot::ReduceLevel(const TileLevel& level, Int_t nThreads){
+
+  /** Builds the next coarser zoom level by averaging 2x2 cells of \p level,
+      weighted by the number of filled bins they cover **/
+
+  TileLevel reduced;
+  reduced.nx = (level.nx + 1)/2;
+  reduced.ny = (level.ny + 1)/2;
+  reduced.values.assign((size_t)reduced.nx*reduced.ny, 0);
+  reduced.weights.assign((size_t)reduced.nx*reduced.ny, 0);
+
+  ParallelFor(reduced.ny, [&](Int_t row){
+    for (UInt_t col = 0; col < reduced.nx; col++){
+
+      Double_t sum = 0, total = 0;
+      for (UInt_t sub = 0; sub < 4; sub++){
+        UInt_t c = 2*col + sub%2, r = 2*row + sub/2;
+        if (c >= level.nx || r >= level.ny) continue;
+        Float_t weight;
+        Float_t value = level.Get(c, r, weight);
+        sum   += weight*value;
+        total += weight;
+      }
+
+      size_t cell = (size_t)row*reduced.nx + col;
+      reduced.weights[cell] = total;
+      reduced.values[cell]  = total > 0 ? sum/total : 0;
+
+    }
+  }, nThreads);
+
+  return reduced;
+
+}
+
+void HeatMapPlot::WriteTiles(const TileLevel& level, TString directory, UInt_t tileSize, const std::vector<UInt_t>& levelColors, Float_t zLow, Float_t zUp, Bool_t zLog, Int_t nThreads){
+
+  /** Colors all cells of \p level and writes them as tiles to \p directory,
+      each tile is painted and encoded on its own thread. \p zLow and \p zUp
+      are given as logarithm for \p zLog. **/
+
+  UInt_t nCols = (level.nx + tileSize - 1)/tileSize;
+  UInt_t nRows = (level.ny + tileSize - 1)/tileSize;
+
+  for (UInt_t col = 0; col < nCols; col++) gSystem->mkdir(Form("%s/%u", directory.Data(), col), kTRUE);
+
+  Double_t scale = levelColors.size()/(zUp - zLow);
+  Int_t nLevels = levelColors.size();
+
+  ParallelFor(nCols*nRows, [&](Int_t tile){
+
+    UInt_t tileCol = tile%nCols, tileRow = tile/nCols;
+    RasterImage image(tileSize, tileSize, 0);
+    UInt_t* pixels = image.GetPixels();
+
+    for (UInt_t y = 0; y < tileSize && tileRow*tileSize + y < level.ny; y++){
+      for (UInt_t x = 0; x < tileSize && tileCol*tileSize + x < level.nx; x++){
+        Float_t weight;
+        Float_t value = level.Get(tileCol*tileSize + x, tileRow*tileSize + y, weight);
+        if (weight <= 0 || (zLog && value <= 0)) continue;
+        if (zLog) value = TMath::Log10(value);
+        if (value < zLow) continue;
+        pixels[y*tileSize + x] = levelColors[std::min(Int_t(0.01 + (value - zLow)*scale), nLevels - 1)];
+      }
+    }
+
+    image.WritePNG(Form("%s/%u/%u.png", directory.Data(), tileCol, tileRow));
+
+  }, nThreads);
+
+}
+
 void HeatMapPlot::SetProperties(TH2* map, std::string title){
 
   /** Manages internal setting of properties for TH2 heatmap plots **/
@@ -593,5 +1061,615 @@ void HeatMapPlot::SetRanges(Float_t xLow, Float_t xUp, Float_t yLow, Float_t yUp
 
 }
 
+// ----------------------------------------------------------------------------
+//                          TIME SERIES PLOT CLASS
+// ----------------------------------------------------------------------------
+
+//! Class for a rolling window of time series, e.g. rates in a monitoring loop
+
+class TimeSeriesPlot : public Plot
+{
+
+public:
+
+  TimeSeriesPlot(TString xTitle, TString yTitle, Double_t window = 86400, UInt_t capacity = 10000);
+  TimeSeriesPlot(const TimeSeriesPlot&) = delete;
+  TimeSeriesPlot& operator=(const TimeSeriesPlot&) = delete;
+  virtual ~TimeSeriesPlot() {}
+
+  Int_t AddSeries(TString title);
+  void AddLegend(TLegend* legend);
+  void Append(Int_t index, Double_t time, Double_t value);
+  void Append(Int_t index, Double_t value) {Append(index, TTimeStamp().AsDouble(), value);} //!< Appends \p value at the current time
+
+  using Plot::Draw;
+  using Plot::Validate;
+  /*virtual*/ void Draw(TString outname);
+  virtual void BuildCanvas();
+
+  void SetWindow(Double_t length) {window = length;}         //!< Set the length of the rolling window in seconds
+  void SetTimeFormat(TString format) {timeFormat = format;}  //!< Set the format of the time axis (cf. TAxis::SetTimeFormat), chosen from the window if empty
+  void SetRanges(Float_t yLow, Float_t yUp);
+  void SetRangesAuto() {fixedY = kFALSE;}                    //!< Let the Y-range follow the points in the window again
+
+  Int_t GetNseries() const {return series.size();}           //!< Number of series
+  UInt_t GetNpoints(Int_t index) const {return series.at(index).size;} //!< Number of points held for series \p index
+
+  static TString GetTimeFormat(Double_t length);
+
+protected:
+
+  virtual void PrepareArrays() {FillGraphs();} //!< Brings the graphs up to date with the ring buffers
+  virtual std::vector<std::pair<TPad*, TObjArray*>> GetPadArrays() {return {{mainPad, &plotArray}};} //!< Pads and their arrays, for Refresh
+
+private:
+
+  //! Fixed-capacity ring buffer holding the points of one series
+  struct Series {
+    std::vector<Double_t> times;        //!< Times of the points
+    std::vector<Double_t> values;       //!< Values of the points
+    UInt_t first {0};                   //!< Position of the oldest point
+    UInt_t size {0};                    //!< Number of points held
+    std::unique_ptr<TGraph> graph;      //!< Graph showing the window, allocated for the full capacity
+    UInt_t shown {0};                   //!< Number of points of the graph that may differ from the last point of the window
+
+    UInt_t Position(UInt_t index) const {return (first + index) % times.size();} //!< Position of the \p index-th oldest point
+  };
+
+  void FillGraphs();
+
+  std::vector<Series> series;           //!< All series
+  std::unique_ptr<TH1F> frame;          //!< Empty histogram carrying the axes
+  TObjArray plotArray;                  //!< Frame, graphs and legends to be drawn
+
+  Double_t window;                      //!< Length of the rolling window in seconds
+  UInt_t   capacity;                    //!< Number of points held per series
+  Double_t timeOffset {0};              //!< Time of the origin of the X-axis
+  TString  timeFormat;                  //!< Format of the time axis
+  Bool_t   fixedY {kFALSE};             //!< Was the Y-range set manually?
+
+};
+
+// ---- Constructor -----------------------------------------------------------
+
+//! Constructor
+TimeSeriesPlot::TimeSeriesPlot(TString xTitle, TString yTitle, Double_t length, UInt_t points): Plot(xTitle, yTitle),
+  frame(new TH1F("timeFrame", "", 1, 0, 1)),
+  window(length),
+  capacity(std::max(points, 1u))
+{
+
+  /** Every series keeps the last \p points points, however long the process
+      runs; the plot shows those of the last \p length seconds **/
+
+  frame->SetDirectory(nullptr);
+  plotArray.Add(frame.get());
+
+  SetCanvasDimensions(1400, 800);
+  SetCanvasMargins(0.03, 0.1, 0.05, 0.13);
+  SetCanvasOffsets(1.3, 1.);
+
+  options = std::vector<std::string>(1, "AXIS");
+
+}
+
+// ---- Member Functions ------------------------------------------------------
+
+Int_t TimeSeriesPlot::AddSeries(TString title){
+
+  /** Adds a new, empty series and returns its index. All memory of the series
+      is allocated here, appending points never allocates. **/
+
+  Series added;
+  added.times.resize(capacity);
+  added.values.resize(capacity);
+  added.graph.reset(new TGraph(capacity));
+  added.graph->SetName(Form("series%d", (Int_t)series.size()));
+  added.graph->SetTitle(title);
+  added.shown = capacity;
+
+  // the graph goes behind the frame and all other series, legends stay last;
+  // AddAt does not grow the array beyond its capacity, AddAtAndExpand does
+  Int_t position = series.size() + 1;
+  std::vector<TObject*> legends;
+  for (Int_t index = position; index < plotArray.GetEntriesFast(); index++) legends.push_back(plotArray.At(index));
+  plotArray.AddAtAndExpand(added.graph.get(), position);
+  for (UInt_t legend = 0; legend < legends.size(); legend++) plotArray.AddAtAndExpand(legends[legend], position + 1 + legend);
+
+  std::vector<std::string>& opts = options.Write();
+  opts.insert(opts.begin() + position, "L");
+
+  series.push_back(std::move(added));
+
+  return series.size() - 1;
+
+}
+
+void TimeSeriesPlot::AddLegend(TLegend* legend){
+
+  /** Adds a legend, drawn on top of all series **/
+
+  plotArray.Add(legend);
+  options.Write().push_back("SAME");
+
+}
+
+void TimeSeriesPlot::Append(Int_t index, Double_t time, Double_t value){
+
+  /** Appends a point (\p time in seconds since the epoch, e.g. TTimeStamp::AsDouble())
+      to series \p index, replacing its oldest point once the capacity is reached.
+      Times are expected to increase. **/
+
+  if (index < 0 || index >= (Int_t)series.size()){
+    std::cout << "\033[1;31mERROR:\033[0m Series " << index << " does not exist! Point will be skipped." << std::endl;
+    return;
+  }
+
+  Series& s = series[index];
+  UInt_t position = s.Position(s.size);
+
+  s.times[position]  = time;
+  s.values[position] = value;
+
+  if (s.size < capacity) s.size++;
+  else s.first = (s.first + 1) % capacity;
+
+}
+
+void TimeSeriesPlot::FillGraphs(){
+
+  /** Copies the points inside the window into the graphs and determines the
+      ranges. Only the window is copied, its beginning is found by bisection.
+      The graphs keep their full capacity: the slots behind the window repeat
+      its last point, so they are never resized. **/
+
+  Double_t latest = -DBL_MAX;
+  for (const Series& s : series){
+    if (s.size) latest = std::max(latest, s.times[s.Position(s.size - 1)]);
+  }
+  if (latest == -DBL_MAX) latest = TTimeStamp().AsDouble();
+
+  Double_t start = latest - window;
+  timeOffset = TMath::Floor(start);  // times relative to the window stay precise in Float_t ranges
+  xRangeLow  = start - timeOffset;
+  xRangeUp   = latest - timeOffset;
+
+  Double_t low = DBL_MAX, up = -DBL_MAX;
+
+  for (Series& s : series){
+
+    UInt_t begin = 0, end = s.size;
+    while (begin < end){
+      UInt_t middle = (begin + end)/2;
+      if (s.times[s.Position(middle)] < start) begin = middle + 1;
+      else end = middle;
+    }
+
+    UInt_t n = s.size - begin;
+    Double_t* x = s.graph->GetX();
+    Double_t* y = s.graph->GetY();
+
+    for (UInt_t point = 0; point < n; point++){
+      UInt_t position = s.Position(begin + point);
+      x[point] = s.times[position] - timeOffset;
+      y[point] = s.values[position];
+      if (logY && y[point] <= 0) continue;
+      low = std::min(low, y[point]);
+      up  = std::max(up, y[point]);
+    }
+
+    Double_t lastX = n ? x[n - 1] : -1;  // an empty window is moved out of the frame
+    Double_t lastY = n ? y[n - 1] : 0;
+    for (UInt_t point = n; point < s.shown; point++){
+      x[point] = lastX;
+      y[point] = lastY;
+    }
+    s.shown = n;
+
+  }
+
+  if (fixedY) return;
+
+  if (low > up){
+    low = logY ? 0.1 : 0;
+    up  = 1;
+  }
+
+  if (logY){
+    yRangeLow = low/2;
+    yRangeUp  = up*2;
+  }
+  else {
+    Double_t margin = (up > low) ? 0.1*(up - low) : std::max(0.1*TMath::Abs(up), 1.);
+    yRangeLow = low - margin;
+    yRangeUp  = up + margin;
+  }
+
+}
+
+void TimeSeriesPlot::Draw(TString outname){
+
+  /** Main function for Drawing **/
+
+  std::cout << "-----------------------------" << std::endl;
+  std::cout << "     Plot Time Series:" << std::endl;
+  std::cout << "-----------------------------" << std::endl;
+
+  if (broken){
+    std::cout << "Due to one or more \033[1;33mFATAL ERRORS\033[0m your Plot will not be drawn" << std::endl;
+    std::cout << "-----------------------------" << std::endl << std::endl;
+    return;
+  }
+
+  BuildCanvas();
+  canvas->SaveAs(outname.Data());
+  ReleaseCanvas();
+
+  std::cout << "-----------------------------" << std::endl << std::endl;
+
+}
+
+void TimeSeriesPlot::BuildCanvas(){
+
+  /** Sets up the canvas with all pads and objects without saving it **/
+
+  FillGraphs();
+
+  frame->SetBins(1, xRangeLow, xRangeUp);
+  frame->GetXaxis()->SetTimeDisplay(1);
+  frame->GetXaxis()->SetTimeFormat(timeFormat.IsNull() ? GetTimeFormat(window).Data() : timeFormat.Data());
+  frame->GetXaxis()->SetTimeOffset(timeOffset, "local");
+  frame->GetXaxis()->SetNdivisions(508);
+
+  canvas  = AcquireCanvas("TIME SERIES", 10, 10, width+10, height+10);
+
+  mainPad = AcquirePad("mainPad", "Time Series", 0, 0, 1, 1);
+  SetUpPad(mainPad, kFALSE, logY);
+  SetPadStyle(frame.get(), titleX, titleY, xRangeUp, xRangeLow, yRangeUp, yRangeLow);
+  SetCanvasStyle(frame.get(), offsetX, offsetY);
+  if (marginsAuto) FitMargins(mainPad, frame.get(), yRangeLow, yRangeUp);
+  mainPad->cd();
+
+  DrawArray(&plotArray, mOffset);
+  PlaceLegends(&plotArray, mainPad, yRangeLow, yRangeUp);
+
+  canvas->Update();
+
+}
+
+void TimeSeriesPlot::SetRanges(Float_t yLow, Float_t yUp){
+
+  /** Fixes the Y-range, the X-range always follows the window **/
+
+  yRangeLow = yLow;
+  yRangeUp  = yUp;
+  fixedY = kTRUE;
+
+}
+
+TString TimeSeriesPlot::GetTimeFormat(Double_t length){
+
+  /** Returns a format for time axes showing \p length seconds **/
+
+  if (length <= 600) return "%H:%M:%S";
+  if (length <= 2*86400) return "%H:%M";
+  if (length <= 60*86400) return "%d.%m.";
+  return "%m/%Y";
+
+}
+
+// ----------------------------------------------------------------------------
+//                              STACK PLOT CLASS
+// ----------------------------------------------------------------------------
+
+//! Class for stacked contributions compared to data, with the ratio data/stack in the lower pad
+
+class StackPlot : public SingleRatioPlot
+{
+
+public:
+
+  StackPlot(TObjArray* contributions, TH1* data, TString xTitle, TString yTitle, TString ratioTitle = "Data/Stack");
+  StackPlot(const StackPlot&) = delete;
+  StackPlot& operator=(const StackPlot&) = delete;
+  virtual ~StackPlot();
+
+  void Rebind(TObjArray* mainArray, TObjArray* rArray) = delete;
+
+  void Update();
+  void AddLegend(TLegend* legend);
+  virtual void BuildCanvas();
+
+  TH1D* GetLayer(Int_t index) const {return layers.at(index);} //!< Stacked histogram of contribution \p index (sum up to it), e.g. for legend entries
+  TH1D* GetBand() const {return band;}                           //!< Total of the stack with its uncertainty
+
+protected:
+
+  virtual void PrepareArrays() {Update();} //!< Restacks the contributions before Refresh checks them
+
+private:
+
+  static Bool_t Compatible(TObjArray* contributions, TH1* data, Bool_t verbose = kTRUE);
+  static TObjArray* NewMainArray(TObjArray* contributions, TH1* data);
+  static TObjArray* NewRatioArray(TObjArray* contributions, TH1* data);
+  static TH1D* NewLayer(TH1* model, TString name);
+
+  TObjArray* contributions;             //!< Contributions in stacking order, from the bottom up
+  TH1* data;                            //!< Data compared to the stack, may be nullptr
+
+  std::vector<TH1D*> layers;            //!< Stacked histograms in stacking order, owned by the plot
+  TH1D* band {nullptr};                 //!< Total of the stack with its uncertainty
+  TH1D* ratioBand {nullptr};            //!< Relative uncertainty of the total around one
+  TH1D* ratio {nullptr};                //!< Data over the total
+
+  std::vector<Double_t> sum;            //!< Running sum of the contents per bin
+  std::vector<Double_t> variance;       //!< Running sum of the squared uncertainties per bin
+
+};
+
+// ---- Constructor -----------------------------------------------------------
+
+//! Constructor
+StackPlot::StackPlot(TObjArray* contribs, TH1* dataHist, TString xTitle, TString yTitle, TString rTitle):
+  SingleRatioPlot(NewMainArray(contribs, dataHist), NewRatioArray(contribs, dataHist), xTitle, yTitle, rTitle),
+  contributions(contribs),
+  data(dataHist)
+{
+
+  /** Stacks the one-dimensional histograms in \p contribs (from the bottom up),
+      which need the binning of \p dataHist. The stacked histograms, the band
+      and the ratios belong to the plot, the inputs are only read. The top of
+      the stack is drawn first and carries the axes, so the style arrays are
+      applied in drawing order: from the top contribution down, then the band
+      and the data. **/
+
+  if (broken) return;
+
+  Int_t nLayers = contributions->GetEntries();
+  for (Int_t layer = 0; layer < nLayers; layer++) layers.push_back((TH1D*)plotArray->At(nLayers - 1 - layer));
+  band = (TH1D*)plotArray->At(nLayers);
+  ratioBand = (TH1D*)ratioArray->At(0);
+  if (data) ratio = (TH1D*)ratioArray->At(1);
+
+  sum.resize(band->GetNcells());
+  variance.resize(band->GetNcells());
+
+  std::vector<std::string>& opts = options.Write();
+  Int_t nMain = plotArray->GetEntries();
+  std::fill(opts.begin(), opts.begin() + nLayers, "HIST SAME");
+  opts[nLayers] = "E2 SAME";
+  if (data) opts[nLayers + 1] = "E SAME";
+  opts[nMain] = "E2 SAME";
+  if (data) opts[nMain + 1] = "E SAME";
+
+}
+
+StackPlot::~StackPlot(){
+
+  /** Deletes the stacked histograms and ratios, the inputs are kept **/
+
+  for (TH1D* layer : layers) delete layer;
+  delete band;
+  delete ratioBand;
+  delete ratio;
+  delete plotArray;
+  delete ratioArray;
+
+}
+
+// ---- Member Functions ------------------------------------------------------
+
+Bool_t StackPlot::Compatible(TObjArray* contributions, TH1* data, Bool_t verbose){
+
+  /** Checks that there are contributions and that they and \p data are
+      one-dimensional histograms with the same number of bins **/
+
+  if (!contributions || !contributions->GetEntries()){
+    if (verbose) std::cout << "\033[1;31mERROR:\033[0m No contributions to stack!" << std::endl;
+    return kFALSE;
+  }
+
+  Int_t nCells = -1;
+
+  for (Int_t index = 0; index <= contributions->GetEntries(); index++){
+
+    TObject* obj = (index < contributions->GetEntries()) ? contributions->At(index) : data;
+    TString name = (index < contributions->GetEntries()) ? Form("Contribution No %d", index) : "Data";
+    if (!obj && index == contributions->GetEntries()) break;  // no data
+
+    if (!obj || !obj->InheritsFrom("TH1") || ((TH1*)obj)->GetDimension() != 1){
+      if (verbose) std::cout << "\033[1;31mERROR:\033[0m " << name << " is not a one-dimensional histogram!" << std::endl;
+      return kFALSE;
+    }
+
+    if (nCells < 0) nCells = ((TH1*)obj)->GetNcells();
+    else if (((TH1*)obj)->GetNcells() != nCells){
+      if (verbose) std::cout << "\033[1;31mERROR:\033[0m " << name << " has a different number of bins than the first contribution!" << std::endl;
+      return kFALSE;
+    }
+
+  }
+
+  return kTRUE;
+
+}
+
+TObjArray* StackPlot::NewMainArray(TObjArray* contributions, TH1* data){
+
+  /** Creates the stacked histograms from the top down and the band, followed
+      by \p data. Stays empty for incompatible inputs, so the plot is broken. **/
+
+  TObjArray* array = new TObjArray();
+  if (!Compatible(contributions, data)) return array;
+
+  for (Int_t layer = contributions->GetEntries() - 1; layer >= 0; layer--){
+    TH1* contribution = (TH1*)contributions->At(layer);
+    TH1D* stacked = NewLayer(contribution, Form("%s_stacked", contribution->GetName()));
+    contribution->TAttLine::Copy(*stacked);
+    contribution->TAttFill::Copy(*stacked);
+    contribution->TAttMarker::Copy(*stacked);
+    array->Add(stacked);
+  }
+
+  TH1D* band = NewLayer((TH1*)contributions->At(0), "stackBand");
+  band->Sumw2();
+  band->SetFillColor(kGray + 2);
+  band->SetFillStyle(3354);
+  band->SetMarkerSize(0);
+  array->Add(band);
+
+  if (data) array->Add(data);
+
+  return array;
+
+}
+
+TObjArray* StackPlot::NewRatioArray(TObjArray* contributions, TH1* data){
+
+  /** Creates the relative uncertainty of the stack and the ratio data/stack **/
+
+  TObjArray* array = new TObjArray();
+  if (!Compatible(contributions, data, kFALSE)) return array;
+
+  TH1D* ratioBand = NewLayer((TH1*)contributions->At(0), "stackRatioBand");
+  ratioBand->Sumw2();
+  ratioBand->SetFillColor(kGray + 2);
+  ratioBand->SetFillStyle(3354);
+  ratioBand->SetMarkerSize(0);
+  array->Add(ratioBand);
+
+  if (data){
+    TH1D* ratio = NewLayer(data, Form("%s_over_stack", data->GetName()));
+    ratio->Sumw2();
+    data->TAttLine::Copy(*ratio);
+    data->TAttMarker::Copy(*ratio);
+    array->Add(ratio);
+  }
+
+  return array;
+
+}
+
+TH1D* StackPlot::NewLayer(TH1* model, TString name){
+
+  /** Creates an empty histogram with the binning of \p model **/
+
+  const TAxis* axis = model->GetXaxis();
+  TH1D* layer = (axis->GetXbins()->GetSize())
+    ? new TH1D(name, model->GetTitle(), axis->GetNbins(), axis->GetXbins()->GetArray())
+    : new TH1D(name, model->GetTitle(), axis->GetNbins(), axis->GetXmin(), axis->GetXmax());
+  layer->SetDirectory(nullptr);
+
+  return layer;
+
+}
+
+void StackPlot::Update(){
+
+  /** Restacks the contributions in one pass: running sums of the contents and
+      squared uncertainties are carried through the contributions and copied
+      into the bin storage of every stacked histogram. The band and both ratios
+      are filled from the same sums. Contributions without Sumw2 count with
+      Poisson uncertainties. Draw and Refresh call this themselves. **/
+
+  if (broken) return;
+
+  Int_t nCells = sum.size();
+  std::fill(sum.begin(), sum.end(), 0.);
+  std::fill(variance.begin(), variance.end(), 0.);
+  Double_t entries = 0;
+
+  for (UInt_t layer = 0; layer < layers.size(); layer++){
+
+    TH1* contribution = (TH1*)contributions->At(layer);
+    Double_t* stacked = layers[layer]->GetArray();
+    const Double_t* below = layer ? layers[layer - 1]->GetArray() : nullptr;
+
+    if (TArrayD* contents = dynamic_cast<TArrayD*>(contribution)){
+      const Double_t* raw = contents->GetArray();
+      for (Int_t cell = 0; cell < nCells; cell++) sum[cell] += raw[cell];
+    }
+    else if (TArrayF* contents = dynamic_cast<TArrayF*>(contribution)){
+      const Float_t* raw = contents->GetArray();
+      for (Int_t cell = 0; cell < nCells; cell++) sum[cell] += raw[cell];
+    }
+    else {
+      for (Int_t cell = 0; cell < nCells; cell++) sum[cell] += contribution->GetBinContent(cell);
+    }
+
+    if (contribution->GetSumw2N()){
+      const Double_t* raw = contribution->GetSumw2()->GetArray();
+      for (Int_t cell = 0; cell < nCells; cell++) variance[cell] += raw[cell];
+    }
+    else {
+      for (Int_t cell = 0; cell < nCells; cell++) variance[cell] += std::abs(sum[cell] - (below ? below[cell] : 0.));
+    }
+
+    std::copy(sum.begin(), sum.end(), stacked);
+    entries += contribution->GetEntries();
+    layers[layer]->SetEntries(entries);
+
+  }
+
+  std::copy(sum.begin(), sum.end(), band->GetArray());
+  std::copy(variance.begin(), variance.end(), band->GetSumw2()->GetArray());
+  band->SetEntries(entries);
+
+  Double_t* bandContents = ratioBand->GetArray();
+  Double_t* bandVariance = ratioBand->GetSumw2()->GetArray();
+  Double_t* ratioContents = ratio ? ratio->GetArray() : nullptr;
+  Double_t* ratioVariance = ratio ? ratio->GetSumw2()->GetArray() : nullptr;
+
+  for (Int_t cell = 0; cell < nCells; cell++){
+
+    Double_t total = sum[cell];
+    bandContents[cell] = total ? 1. : 0.;
+    bandVariance[cell] = total ? variance[cell]/(total*total) : 0.;
+
+    if (!ratio) continue;
+
+    Double_t error = data->GetBinError(cell);
+    ratioContents[cell] = total ? data->GetBinContent(cell)/total : 0.;
+    ratioVariance[cell] = total ? error*error/(total*total) : 0.;
+
+  }
+
+  ratioBand->SetEntries(entries);
+  if (ratio) ratio->SetEntries(data->GetEntries());
+
+}
+
+void StackPlot::AddLegend(TLegend* legend){
+
+  /** Adds a legend to the upper pad, drawn on top of the stack and the data.
+      Entries should refer to the stacked histograms (cf. GetLayer) and the
+      band to show their fill. **/
+
+  std::vector<std::string>& opts = options.Write();
+  opts.insert(opts.begin() + plotArray->GetEntries(), "SAME");
+  plotArray->Add(legend);
+
+}
+
+void StackPlot::BuildCanvas(){
+
+  /** Restacks the contributions and sets up the canvas. With the style arrays
+      the stacked histograms are filled in their colors. **/
+
+  Update();
+
+  if (styles){
+    for (UInt_t position = 0; position < layers.size(); position++){
+      UInt_t index = position + mOffset;
+      TH1D* layer = layers[layers.size() - 1 - position];
+      layer->SetFillColor(index < colors.size() ? colors[index] : (Color_t)kBlack);
+      layer->SetFillStyle(1001);
+    }
+  }
+
+  SingleRatioPlot::BuildCanvas();
+
+}
+
 
 //
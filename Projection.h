@@ -0,0 +1,367 @@
+// ~~ PROJECTION ~~
+
+// ----------------------------------------------------------------------------
+//
+// This file contains the projection service for multi-dimensional
+// histograms (THn and THnSparse). Analyses plot dozens of one- and two-
+// dimensional projections and profiles of the same histogram with different
+// cuts on the other axes, and every THnBase::Projection call decodes all
+// filled bins again. The service collects the requested projections and
+// profiles and computes all of them in a single pass over the bins: the
+// coordinates of a block of bins are decoded once and the projections are
+// then filled from the block in parallel, one projection per thread. The
+// projections are kept until the histogram is filled again and can be
+// handed to the plots as arrays.
+//
+// ----------------------------------------------------------------------------
+
+#define PROJECTION_H
+
+// ----------------------------------------------------------------------------
+//                           PROJECTION SERVICE CLASS
+// ----------------------------------------------------------------------------
+
+//! Class for computing many projections and profiles of a THn or THnSparse in one pass
+
+class ProjectionService
+{
+
+public:
+
+  //! Restriction of one axis to the bins containing [low, up]
+  struct Cut {
+    Int_t    axis;                       //!< Axis to be restricted
+    Double_t low;                        //!< Lower edge of the accepted range
+    Double_t up;                         //!< Upper edge of the accepted range
+  };
+
+  ProjectionService(THnBase* hist, Int_t nThreads = 0);
+  ProjectionService(const ProjectionService&) = delete;
+  ProjectionService& operator=(const ProjectionService&) = delete;
+  ~ProjectionService() {}
+
+  Int_t Request(std::vector<Int_t> axes, std::vector<Cut> cuts = {}, TString name = "");
+  Int_t RequestProfile(Int_t axis, Int_t valueAxis, std::vector<Cut> cuts = {}, TString name = "");
+  void Run();
+  TH1* Get(Int_t index);
+  TObjArray* GetArray(std::vector<Int_t> indices);
+  void Clear() {requests.clear(); keys.clear();} //!< Deletes all requests and their projections
+
+  Int_t GetNrequests() const {return requests.size();} //!< Number of requested projections
+  Int_t GetNpasses() const {return nPasses;}           //!< Number of passes over the bins so far
+
+private:
+
+  //! One requested projection or profile
+  struct Projection {
+    std::vector<Int_t> axes;             //!< Projected axes (X and optionally Y)
+    Int_t valueAxis {-1};                //!< Axis whose mean is profiled, -1 for projections
+    std::vector<Double_t> values;        //!< Bin centers of the profiled axis
+    std::vector<Int_t> first;            //!< First accepted bin per axis
+    std::vector<Int_t> last;             //!< Last accepted bin per axis
+    Bool_t cut {kFALSE};                 //!< Is any axis restricted?
+    std::unique_ptr<TH1> result;         //!< Projection, owned by the service
+    Bool_t done {kFALSE};                //!< Is the projection up to date?
+  };
+
+  Int_t Insert(std::vector<Int_t> axes, Int_t valueAxis, std::vector<Cut> cuts, TString name);
+  static std::vector<Double_t> GetEdges(const TAxis* axis);
+  ULong64_t Fingerprint() const;
+
+  THnBase* hist;                         //!< Projected histogram
+  Int_t nThreads;                        //!< Number of threads filling the projections
+
+  std::vector<Projection> requests;      //!< All requested projections
+  std::map<std::string, Int_t> keys;     //!< Index of every projection by axes and cuts
+  ULong64_t filled {0};                  //!< Fingerprint of the histogram at the last pass
+  Int_t nPasses {0};                     //!< Number of passes over the bins so far
+
+  static constexpr Long64_t blockSize {1 << 18}; //!< Number of bins decoded at a time
+
+};
+
+// ---- Constructor -----------------------------------------------------------
+
+//! Constructor
+ProjectionService::ProjectionService(THnBase* hist, Int_t nThreads):
+  hist(hist),
+  nThreads(nThreads)
+{
+
+  /** Projects \p hist using \p nThreads threads (all hardware threads if 0).
+      The histogram is only read. **/
+
+}
+
+// ---- Member Functions ------------------------------------------------------
+
+Int_t ProjectionService::Request(std::vector<Int_t> axes, std::vector<Cut> cuts, TString name){
+
+  /** Requests the projection of the histogram onto one or two \p axes (X, Y),
+      restricted by \p cuts, and returns its index. Nothing is computed before
+      the projection is needed (cf. Run), and a request with the same axes and
+      cuts returns the index of the existing one. **/
+
+  if (axes.empty() || axes.size() > 2){
+    std::cout << "\033[1;31mERROR:\033[0m Projections need one or two axes! Request will be skipped." << std::endl;
+    return -1;
+  }
+
+  return Insert(axes, -1, cuts, name);
+
+}
+
+Int_t ProjectionService::RequestProfile(Int_t axis, Int_t valueAxis, std::vector<Cut> cuts, TString name){
+
+  /** Requests the profile of \p valueAxis along \p axis, i.e. the mean and
+      RMS of the bin centers of \p valueAxis in every bin of \p axis (a TProfile),
+      restricted by \p cuts, and returns its index. Like TH2::ProfileX, the
+      under- and overflow of \p valueAxis are left out unless it is cut.
+      Profiles are computed in the same pass as the projections. **/
+
+  if (valueAxis < 0 || axis == valueAxis){
+    std::cout << "\033[1;31mERROR:\033[0m Profiles need two different axes! Request will be skipped." << std::endl;
+    return -1;
+  }
+
+  return Insert({axis}, valueAxis, cuts, name);
+
+}
+
+Int_t ProjectionService::Insert(std::vector<Int_t> axes, Int_t valueAxis, std::vector<Cut> cuts, TString name){
+
+  /** Adds the projection onto \p axes (profiling \p valueAxis if not negative)
+      unless it was requested before, and returns its index **/
+
+  Int_t nDims = hist->GetNdimensions();
+
+  std::string key;
+  for (Int_t axis : axes){
+    if (axis < 0 || axis >= nDims){
+      std::cout << "\033[1;31mERROR:\033[0m Axis " << axis << " does not exist! Request will be skipped." << std::endl;
+      return -1;
+    }
+    key += Form("%d,", axis);
+  }
+
+  if (valueAxis >= nDims){
+    std::cout << "\033[1;31mERROR:\033[0m Axis " << valueAxis << " does not exist! Request will be skipped." << std::endl;
+    return -1;
+  }
+
+  Projection projection;
+  projection.axes = axes;
+  projection.valueAxis = valueAxis;
+  projection.first.assign(nDims, 0);
+  for (Int_t axis = 0; axis < nDims; axis++) projection.last.push_back(hist->GetAxis(axis)->GetNbins() + 1);
+
+  if (valueAxis >= 0){
+    TAxis* axis = hist->GetAxis(valueAxis);
+    for (Int_t bin = 0; bin <= axis->GetNbins() + 1; bin++) projection.values.push_back(axis->GetBinCenter(bin));
+    if (std::none_of(cuts.begin(), cuts.end(), [valueAxis](const Cut& cut){return cut.axis == valueAxis;})){
+      projection.first[valueAxis] = 1;
+      projection.last[valueAxis]  = axis->GetNbins();
+    }
+  }
+
+  for (const Cut& cut : cuts){
+    if (cut.axis < 0 || cut.axis >= nDims){
+      std::cout << "\033[1;31mERROR:\033[0m Axis " << cut.axis << " does not exist! Request will be skipped." << std::endl;
+      return -1;
+    }
+    TAxis* axis = hist->GetAxis(cut.axis);
+    projection.first[cut.axis] = std::max(projection.first[cut.axis], axis->FindFixBin(cut.low));
+    projection.last[cut.axis]  = std::min(projection.last[cut.axis], axis->FindFixBin(cut.up));
+    projection.cut = kTRUE;
+  }
+
+  key += Form("%d:", valueAxis);
+  for (Int_t axis = 0; axis < nDims; axis++) key += Form("%d-%d,", projection.first[axis], projection.last[axis]);
+
+  auto existing = keys.find(key);
+  if (existing != keys.end()) return existing->second;
+
+  Int_t index = requests.size();
+  if (name.IsNull()) name = Form("%s_proj_%d", hist->GetName(), index);
+
+  TAxis* xAxis = hist->GetAxis(axes[0]);
+  std::vector<Double_t> xEdges = GetEdges(xAxis);
+
+  if (valueAxis >= 0){
+    projection.result.reset(new TProfile(name, "", xEdges.size() - 1, xEdges.data()));
+    projection.result->GetYaxis()->SetTitle(hist->GetAxis(valueAxis)->GetTitle());
+  }
+  else if (axes.size() == 1){
+    projection.result.reset(new TH1D(name, "", xEdges.size() - 1, xEdges.data()));
+  }
+  else {
+    std::vector<Double_t> yEdges = GetEdges(hist->GetAxis(axes[1]));
+    projection.result.reset(new TH2D(name, "", xEdges.size() - 1, xEdges.data(), yEdges.size() - 1, yEdges.data()));
+    projection.result->GetYaxis()->SetTitle(hist->GetAxis(axes[1])->GetTitle());
+  }
+
+  projection.result->SetDirectory(nullptr);
+  projection.result->GetXaxis()->SetTitle(xAxis->GetTitle());
+  if (hist->GetCalculateErrors()) projection.result->Sumw2();
+
+  requests.push_back(std::move(projection));
+  keys[key] = index;
+
+  return index;
+
+}
+
+void ProjectionService::Run(){
+
+  /** Computes all projections and profiles that are not up to date in a single pass over
+      the bins of the histogram. If the histogram was filled since the last
+      pass, all projections are computed again. **/
+
+  ULong64_t fingerprint = Fingerprint();
+  if (fingerprint != filled){
+    for (Projection& projection : requests) projection.done = kFALSE;
+    filled = fingerprint;
+  }
+
+  std::vector<Projection*> pending;
+  for (Projection& projection : requests){
+    if (projection.done) continue;
+    projection.result->Reset();
+    pending.push_back(&projection);
+  }
+  if (pending.empty()) return;
+
+  Int_t nDims = hist->GetNdimensions();
+  Long64_t nBins = hist->GetNbins();
+  Bool_t errors = hist->GetCalculateErrors();
+
+  std::vector<Int_t> coordinates(std::min(nBins, blockSize)*nDims);
+  std::vector<Double_t> contents(std::min(nBins, blockSize));
+  std::vector<Double_t> errors2(errors ? contents.size() : 0);
+
+  for (Long64_t start = 0; start < nBins; start += blockSize){
+
+    // decoding the coordinates is not thread-safe for THnSparse, so it is done once here
+    Long64_t n = std::min(blockSize, nBins - start);
+    for (Long64_t bin = 0; bin < n; bin++){
+      contents[bin] = hist->GetBinContent(start + bin, &coordinates[bin*nDims]);
+      if (errors) errors2[bin] = hist->GetBinError2(start + bin);
+    }
+
+    ParallelFor(pending.size(), [&](Int_t task){
+
+      Projection& projection = *pending[task];
+      TH1* result = projection.result.get();
+      TProfile* profile = (projection.valueAxis < 0) ? nullptr : (TProfile*)result;
+
+      // profiles sum weight*value in the bins, weight*value^2 in Sumw2 and the weights separately
+      Double_t* sum = dynamic_cast<TArrayD*>(result)->GetArray();
+      Double_t* variance = (errors || profile) ? result->GetSumw2()->GetArray() : nullptr;
+      Double_t* weights  = profile ? profile->GetB() : nullptr;
+      Double_t* weights2 = profile ? profile->GetB2() : nullptr;
+
+      Int_t xAxis = projection.axes[0];
+      Int_t yAxis = (projection.axes.size() > 1) ? projection.axes[1] : -1;
+      Int_t stride = result->GetNbinsX() + 2;
+
+      for (Long64_t bin = 0; bin < n; bin++){
+
+        if (!contents[bin] && (!errors || !errors2[bin])) continue;  // empty bins of a THn
+
+        const Int_t* coordinate = &coordinates[bin*nDims];
+        Bool_t accepted = kTRUE;
+        for (Int_t axis = 0; axis < nDims && accepted; axis++){
+          accepted = coordinate[axis] >= projection.first[axis] && coordinate[axis] <= projection.last[axis];
+        }
+        if (!accepted) continue;
+
+        Int_t cell = coordinate[xAxis] + ((yAxis < 0) ? 0 : stride*coordinate[yAxis]);
+
+        if (profile){
+          Double_t value = projection.values[coordinate[projection.valueAxis]];
+          sum[cell]      += contents[bin]*value;
+          variance[cell] += contents[bin]*value*value;
+          weights[cell]  += contents[bin];
+          if (weights2) weights2[cell] += errors ? errors2[bin] : contents[bin]*contents[bin];
+          continue;
+        }
+
+        sum[cell] += contents[bin];
+        if (variance) variance[cell] += errors2[bin];
+
+      }
+
+    }, nThreads);
+
+  }
+
+  for (Projection* projection : pending){
+    TH1* result = projection->result.get();
+    result->ResetStats();
+    if (!projection->cut && projection->valueAxis < 0) result->SetEntries(hist->GetEntries());
+    projection->done = kTRUE;
+  }
+
+  nPasses++;
+
+}
+
+TH1* ProjectionService::Get(Int_t index){
+
+  /** Returns projection \p index (a TH1D, TH2D or TProfile), computing all
+      outstanding projections first. It belongs to the service. **/
+
+  if (index < 0 || index >= (Int_t)requests.size()){
+    std::cout << "\033[1;31mERROR:\033[0m Projection " << index << " was not requested!" << std::endl;
+    return nullptr;
+  }
+
+  Run();
+
+  return requests[index].result.get();
+
+}
+
+TObjArray* ProjectionService::GetArray(std::vector<Int_t> indices){
+
+  /** Returns a new array with the projections \p indices, e.g. for a
+      SquarePlot or, with a two-dimensional projection first, a HeatMapPlot.
+      All outstanding projections are computed in one pass first. The array
+      belongs to the caller, the projections to the service. **/
+
+  Run();
+
+  TObjArray* array = new TObjArray();
+  for (Int_t index : indices) array->Add(Get(index));
+
+  return array;
+
+}
+
+std::vector<Double_t> ProjectionService::GetEdges(const TAxis* axis){
+
+  /** Returns the bin edges of \p axis **/
+
+  std::vector<Double_t> edges;
+  for (Int_t bin = 1; bin <= axis->GetNbins(); bin++) edges.push_back(axis->GetBinLowEdge(bin));
+  edges.push_back(axis->GetBinUpEdge(axis->GetNbins()));
+
+  return edges;
+
+}
+
+ULong64_t ProjectionService::Fingerprint() const {
+
+  /** Summarizes the fill state of the histogram from its number of entries
+      and filled bins **/
+
+  Double_t entries = hist->GetEntries();
+  ULong64_t bits;
+  std::memcpy(&bits, &entries, sizeof(bits));
+
+  ULong64_t hash = 14695981039346656037ULL;
+  for (ULong64_t value : {(ULong64_t)hist, bits, (ULong64_t)hist->GetNbins()}) hash = (hash ^ value)*1099511628211ULL;
+
+  return hash;
+
+}
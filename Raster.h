@@ -0,0 +1,1133 @@
+// ~~ RASTER ~~
+
+// ----------------------------------------------------------------------------
+//
+// This file contains the native raster backend for simple plots
+//  - RasterImage: RGBA pixel buffer with the few primitives needed for
+//                 marker and line plots (lines, markers, boxes and a
+//                 built-in bitmap font), downscaling and a PNG encoder
+//  - RasterPainter: paints histograms, graphs, functions, lines, markers,
+//                   axes and legends into a RasterImage, using the line,
+//                   marker and fill attributes of the objects
+// Plots drawn with the raster backend skip the ROOT graphics stack
+// completely, which makes thumbnails much cheaper to produce. The text is
+// drawn with a fixed 5x7 pixel font, TLatex markup is stripped.
+//
+// ----------------------------------------------------------------------------
+
+#define RASTER_H
+
+// ----------------------------------------------------------------------------
+//                             RASTER IMAGE CLASS
+// ----------------------------------------------------------------------------
+
+//! RGBA image with basic drawing primitives and PNG output
+
+class RasterImage
+{
+
+public:
+
+  RasterImage(UInt_t w, UInt_t h, UInt_t background = 0xffffffff);
+  ~RasterImage() {}
+
+  static RasterImage FromArgb(const UInt_t* argb, UInt_t w, UInt_t h);
+  RasterImage Downscale(UInt_t w, UInt_t h) const;
+
+  UInt_t GetWidth() const {return width;}   //!< Width in pixels
+  UInt_t GetHeight() const {return height;} //!< Height in pixels
+  UInt_t* GetPixels() {return pixels.data();} //!< Direct access to the pixels, packed as R | G << 8 | B << 16 | A << 24
+
+  void SetZoom(Double_t factor) {zoom = factor;} //!< Scale line widths, marker and text sizes, e.g. for images larger than the canvas
+  Double_t GetZoom() const {return zoom;}        //!< Factor applied to line widths, marker and text sizes
+
+  void SetFrame(Int_t x1, Int_t y1, Int_t x2, Int_t y2, Double_t xRangeLow, Double_t xRangeUp, Double_t yRangeLow, Double_t yRangeUp, Bool_t xLog = kFALSE, Bool_t yLog = kFALSE);
+  void SetClip(Bool_t frame);
+  Double_t ToX(Double_t x) const;
+  Double_t ToY(Double_t y) const;
+  Int_t ToPixel(Double_t coordinate) const;
+
+  Int_t GetFrameX1() const {return frameX1;} //!< Left edge of the frame (pixels)
+  Int_t GetFrameX2() const {return frameX2;} //!< Right edge of the frame (pixels)
+  Int_t GetFrameY1() const {return frameY1;} //!< Upper edge of the frame (pixels)
+  Int_t GetFrameY2() const {return frameY2;} //!< Lower edge of the frame (pixels)
+  Double_t GetXlow() const {return xLow;}    //!< Lower X-axis range
+  Double_t GetXup() const {return xUp;}      //!< Upper X-axis range
+  Double_t GetYlow() const {return yLow;}    //!< Lower Y-axis range
+  Double_t GetYup() const {return yUp;}      //!< Upper Y-axis range
+  Bool_t GetLogX() const {return logX;}      //!< Is the X-axis logarithmic?
+  Bool_t GetLogY() const {return logY;}      //!< Is the Y-axis logarithmic?
+
+  void FillRect(Int_t x1, Int_t y1, Int_t x2, Int_t y2, UInt_t color);
+  void DrawLine(Double_t x1, Double_t y1, Double_t x2, Double_t y2, UInt_t color, Double_t lwidth = 1, Style_t lstyle = 1);
+  void DrawPolyLine(const std::vector<Double_t>& x, const std::vector<Double_t>& y, UInt_t color, Double_t lwidth = 1, Style_t lstyle = 1);
+  void DrawMarker(Double_t x, Double_t y, Style_t mstyle, Size_t msize, UInt_t color);
+  void DrawText(Int_t x, Int_t y, const std::string& text, UInt_t color, Int_t scale = 1, Int_t align = 11, Bool_t vertical = kFALSE);
+
+  Bool_t WritePNG(TString filename) const;
+
+  static UInt_t GetColor(Color_t color);
+  static Int_t GetTextWidth(const std::string& text, Int_t scale) {return text.empty() ? 0 : (6*text.size() - 1)*scale;} //!< Width of \p text in pixels
+  static Int_t GetTextHeight(Int_t scale) {return 7*scale;}                                                              //!< Height of a line of text in pixels
+  static std::string PlainText(TString latex);
+
+private:
+
+  void Span(Int_t x1, Int_t x2, Int_t y, UInt_t color);
+  void Segment(Double_t x1, Double_t y1, Double_t x2, Double_t y2, UInt_t color, Int_t lwidth, const std::vector<Double_t>& dashes);
+  static std::vector<Double_t> GetDashes(Style_t lstyle, Int_t lwidth);
+  static Bool_t InsidePolygon(const Double_t* polygon, Int_t nPoints, Double_t x, Double_t y);
+
+  UInt_t width;                     //!< Width in pixels
+  UInt_t height;                    //!< Height in pixels
+  std::vector<UInt_t> pixels;       //!< Pixels, row by row from the top, packed as R | G << 8 | B << 16 | A << 24
+
+  Int_t clipX1 {0};                 //!< Left edge of the drawable region
+  Int_t clipX2 {0};                 //!< Right edge of the drawable region
+  Int_t clipY1 {0};                 //!< Upper edge of the drawable region
+  Int_t clipY2 {0};                 //!< Lower edge of the drawable region
+
+  Int_t frameX1 {0};                //!< Left edge of the frame
+  Int_t frameX2 {0};                //!< Right edge of the frame
+  Int_t frameY1 {0};                //!< Upper edge of the frame
+  Int_t frameY2 {0};                //!< Lower edge of the frame
+  Double_t xLow {0};                //!< Lower X-axis range
+  Double_t xUp {1};                 //!< Upper X-axis range
+  Double_t yLow {0};                //!< Lower Y-axis range
+  Double_t yUp {1};                 //!< Upper Y-axis range
+  Double_t xMin {0};                //!< Left end of the X-axis (log10 for logarithmic axes)
+  Double_t xMax {1};                //!< Right end of the X-axis (log10 for logarithmic axes)
+  Double_t yMin {0};                //!< Lower end of the Y-axis (log10 for logarithmic axes)
+  Double_t yMax {1};                //!< Upper end of the Y-axis (log10 for logarithmic axes)
+  Bool_t   logX {kFALSE};           //!< Is the X-axis logarithmic?
+  Bool_t   logY {kFALSE};           //!< Is the Y-axis logarithmic?
+
+  Double_t dashPhase {0};           //!< Position in the dash pattern, continued between the segments of a polyline
+  Double_t zoom {1};                //!< Factor applied to line widths, marker and text sizes
+
+  static const UChar_t glyphs[95][5]; //!< 5x7 font for the printable ASCII characters, one byte per column
+
+};
+
+// ---- Static Member Variables -----------------------------------------------
+
+const UChar_t RasterImage::glyphs[95][5] = {
+  {0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00}, {0x14,0x7F,0x14,0x7F,0x14}, //   ! " #
+  {0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62}, {0x36,0x49,0x55,0x22,0x50}, {0x00,0x05,0x03,0x00,0x00}, // $ % & '
+  {0x00,0x1C,0x22,0x41,0x00}, {0x00,0x41,0x22,0x1C,0x00}, {0x08,0x2A,0x1C,0x2A,0x08}, {0x08,0x08,0x3E,0x08,0x08}, // ( ) * +
+  {0x00,0x50,0x30,0x00,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x60,0x60,0x00,0x00}, {0x20,0x10,0x08,0x04,0x02}, // , - . /
+  {0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00}, {0x42,0x61,0x51,0x49,0x46}, {0x21,0x41,0x45,0x4B,0x31}, // 0 1 2 3
+  {0x18,0x14,0x12,0x7F,0x10}, {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x30}, {0x01,0x71,0x09,0x05,0x03}, // 4 5 6 7
+  {0x36,0x49,0x49,0x49,0x36}, {0x06,0x49,0x49,0x29,0x1E}, {0x00,0x36,0x36,0x00,0x00}, {0x00,0x56,0x36,0x00,0x00}, // 8 9 : ;
+  {0x08,0x14,0x22,0x41,0x00}, {0x14,0x14,0x14,0x14,0x14}, {0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x51,0x09,0x06}, // < = > ?
+  {0x32,0x49,0x79,0x41,0x3E}, {0x7E,0x11,0x11,0x11,0x7E}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22}, // @ A B C
+  {0x7F,0x41,0x41,0x22,0x1C}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01}, {0x3E,0x41,0x49,0x49,0x7A}, // D E F G
+  {0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00}, {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41}, // H I J K
+  {0x7F,0x40,0x40,0x40,0x40}, {0x7F,0x02,0x0C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E}, // L M N O
+  {0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46}, {0x46,0x49,0x49,0x49,0x31}, // P Q R S
+  {0x01,0x01,0x7F,0x01,0x01}, {0x3F,0x40,0x40,0x40,0x3F}, {0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F}, // T U V W
+  {0x63,0x14,0x08,0x14,0x63}, {0x07,0x08,0x70,0x08,0x07}, {0x61,0x51,0x49,0x45,0x43}, {0x00,0x7F,0x41,0x41,0x00}, // X Y Z [
+  {0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x7F,0x00}, {0x04,0x02,0x01,0x02,0x04}, {0x40,0x40,0x40,0x40,0x40}, // \ ] ^ _
+  {0x00,0x01,0x02,0x04,0x00}, {0x20,0x54,0x54,0x54,0x78}, {0x7F,0x48,0x44,0x44,0x38}, {0x38,0x44,0x44,0x44,0x20}, // ` a b c
+  {0x38,0x44,0x44,0x48,0x7F}, {0x38,0x54,0x54,0x54,0x18}, {0x08,0x7E,0x09,0x01,0x02}, {0x0C,0x52,0x52,0x52,0x3E}, // d e f g
+  {0x7F,0x08,0x04,0x04,0x78}, {0x00,0x44,0x7D,0x40,0x00}, {0x20,0x40,0x44,0x3D,0x00}, {0x7F,0x10,0x28,0x44,0x00}, // h i j k
+  {0x00,0x41,0x7F,0x40,0x00}, {0x7C,0x04,0x18,0x04,0x78}, {0x7C,0x08,0x04,0x04,0x78}, {0x38,0x44,0x44,0x44,0x38}, // l m n o
+  {0x7C,0x14,0x14,0x14,0x08}, {0x08,0x14,0x14,0x18,0x7C}, {0x7C,0x08,0x04,0x04,0x08}, {0x48,0x54,0x54,0x54,0x20}, // p q r s
+  {0x04,0x3F,0x44,0x40,0x20}, {0x3C,0x40,0x40,0x20,0x7C}, {0x1C,0x20,0x40,0x20,0x1C}, {0x3C,0x40,0x30,0x40,0x3C}, // t u v w
+  {0x44,0x28,0x10,0x28,0x44}, {0x0C,0x50,0x50,0x50,0x3C}, {0x44,0x64,0x54,0x4C,0x44}, {0x00,0x08,0x36,0x41,0x00}, // x y z {
+  {0x00,0x00,0x7F,0x00,0x00}, {0x00,0x41,0x36,0x08,0x00}, {0x08,0x04,0x08,0x10,0x08}                              // | } ~
+};
+
+// ---- Constructor -----------------------------------------------------------
+
+//! Constructor
+RasterImage::RasterImage(UInt_t w, UInt_t h, UInt_t background):
+  width(w),
+  height(h),
+  pixels((size_t)w*h, background)
+{
+
+  frameX2 = clipX2 = (Int_t)width - 1;
+  frameY2 = clipY2 = (Int_t)height - 1;
+
+}
+
+// ---- Member Functions ------------------------------------------------------
+
+RasterImage RasterImage::FromArgb(const UInt_t* argb, UInt_t w, UInt_t h){
+
+  /** Creates an image from packed ARGB pixels (A << 24 | R << 16 | G << 8 | B),
+      as returned by TImage::GetArgbArray **/
+
+  RasterImage image(w, h);
+
+  for (size_t index = 0; index < image.pixels.size(); index++){
+    UInt_t pixel = argb[index];
+    image.pixels[index] = (pixel & 0xff00ff00) | ((pixel >> 16) & 0xff) | ((pixel & 0xff) << 16);
+  }
+
+  return image;
+
+}
+
+RasterImage RasterImage::Downscale(UInt_t w, UInt_t h) const {
+
+  /** Returns a copy of the image reduced to \p w x \p h pixels. Every target
+      pixel is the average of the source pixels it covers, weighted by the
+      covered area, so thin lines fade instead of disappearing. The image is
+      reduced row-wise first and column-wise afterwards. **/
+
+  if (w == width && h == height) return *this;
+  if (!w || !h || w > width || h > height){
+    std::cout << "\033[1;31mERROR:\033[0m Image of " << width << " x " << height << " pixels cannot be reduced to "
+              << w << " x " << h << " pixels!" << std::endl;
+    return *this;
+  }
+
+  //! Source pixels covered by a target pixel and their weights
+  struct Footprint { UInt_t first; std::vector<Float_t> weights; };
+
+  auto footprints = [](UInt_t source, UInt_t target){
+    std::vector<Footprint> result(target);
+    Double_t ratio = (Double_t)source/target;
+    for (UInt_t index = 0; index < target; index++){
+      Double_t low = index*ratio, up = (index + 1)*ratio;
+      result[index].first = (UInt_t)low;
+      for (UInt_t pixel = (UInt_t)low; pixel < std::min((UInt_t)TMath::Ceil(up), source); pixel++)
+        result[index].weights.push_back((std::min(up, pixel + 1.) - std::max(low, (Double_t)pixel))/ratio);
+    }
+    return result;
+  };
+
+  std::vector<Footprint> columns = footprints(width, w), rows = footprints(height, h);
+
+  // one float per channel and pixel of the intermediate image (w x height)
+  std::vector<Float_t> reduced(4*(size_t)w*height, 0);
+
+  for (UInt_t row = 0; row < height; row++){
+    const UInt_t* source = pixels.data() + (size_t)row*width;
+    Float_t* target = reduced.data() + 4*(size_t)row*w;
+    for (UInt_t col = 0; col < w; col++){
+      const Footprint& footprint = columns[col];
+      for (size_t pixel = 0; pixel < footprint.weights.size(); pixel++){
+        UInt_t value = source[footprint.first + pixel];
+        for (Int_t channel = 0; channel < 4; channel++) target[4*col + channel] += footprint.weights[pixel]*((value >> (8*channel)) & 0xff);
+      }
+    }
+  }
+
+  RasterImage image(w, h);
+
+  for (UInt_t row = 0; row < h; row++){
+    const Footprint& footprint = rows[row];
+    for (UInt_t col = 0; col < w; col++){
+      Float_t sum[4] = {0, 0, 0, 0};
+      for (size_t pixel = 0; pixel < footprint.weights.size(); pixel++){
+        const Float_t* source = reduced.data() + 4*((size_t)(footprint.first + pixel)*w + col);
+        for (Int_t channel = 0; channel < 4; channel++) sum[channel] += footprint.weights[pixel]*source[channel];
+      }
+      UInt_t value = 0;
+      for (Int_t channel = 0; channel < 4; channel++) value |= (UInt_t)std::min(TMath::Nint(sum[channel]), 255) << (8*channel);
+      image.pixels[(size_t)row*w + col] = value;
+    }
+  }
+
+  return image;
+
+}
+
+void RasterImage::SetFrame(Int_t x1, Int_t y1, Int_t x2, Int_t y2, Double_t xRangeLow, Double_t xRangeUp, Double_t yRangeLow, Double_t yRangeUp, Bool_t xLog, Bool_t yLog){
+
+  /** Sets the frame, spanning the pixels from (\p x1, \p y1) (upper left) to
+      (\p x2, \p y2) (lower right), and the axis ranges used by ToX and ToY **/
+
+  frameX1 = x1;
+  frameX2 = x2;
+  frameY1 = y1;
+  frameY2 = y2;
+
+  xLow = xRangeLow;
+  xUp  = xRangeUp;
+  yLow = yRangeLow;
+  yUp  = yRangeUp;
+
+  logX = xLog && xLow > 0 && xUp > 0;
+  logY = yLog && yLow > 0 && yUp > 0;
+
+  xMin = logX ? TMath::Log10(xLow) : xLow;
+  xMax = logX ? TMath::Log10(xUp)  : xUp;
+  yMin = logY ? TMath::Log10(yLow) : yLow;
+  yMax = logY ? TMath::Log10(yUp)  : yUp;
+
+}
+
+void RasterImage::SetClip(Bool_t frame){
+
+  /** Restricts all drawing to the frame (\p frame = kTRUE) or to the whole image **/
+
+  clipX1 = frame ? std::max(frameX1, 0) : 0;
+  clipX2 = frame ? std::min(frameX2, (Int_t)width - 1) : (Int_t)width - 1;
+  clipY1 = frame ? std::max(frameY1, 0) : 0;
+  clipY2 = frame ? std::min(frameY2, (Int_t)height - 1) : (Int_t)height - 1;
+
+}
+
+Double_t RasterImage::ToX(Double_t x) const {
+
+  /** Converts the user coordinate \p x to a pixel column, NaN if it cannot be shown **/
+
+  if (logX){
+    if (x <= 0) return NAN;
+    x = TMath::Log10(x);
+  }
+
+  return frameX1 + (x - xMin)/(xMax - xMin)*(frameX2 - frameX1);
+
+}
+
+Double_t RasterImage::ToY(Double_t y) const {
+
+  /** Converts the user coordinate \p y to a pixel row, NaN if it cannot be shown **/
+
+  if (logY){
+    if (y <= 0) return NAN;
+    y = TMath::Log10(y);
+  }
+
+  return frameY2 - (y - yMin)/(yMax - yMin)*(frameY2 - frameY1);
+
+}
+
+Int_t RasterImage::ToPixel(Double_t coordinate) const {
+
+  /** Rounds the pixel position \p coordinate, clamped to the image plus a
+      margin of its size, so that positions far outside (e.g. tiny values on a
+      logarithmic axis) stay in range of Int_t **/
+
+  Double_t margin = std::max(width, height);
+
+  return TMath::Nint(std::min(std::max(coordinate, -margin), 2*margin));
+
+}
+
+void RasterImage::Span(Int_t x1, Int_t x2, Int_t y, UInt_t color){
+
+  /** Fills the pixels \p x1 to \p x2 of row \p y, clipped to the drawable region.
+      All painting ends up here: a contiguous fill of one row, which the compiler
+      turns into vector stores. **/
+
+  if (y < clipY1 || y > clipY2) return;
+
+  x1 = std::max(x1, clipX1);
+  x2 = std::min(x2, clipX2);
+  if (x1 > x2) return;
+
+  std::fill_n(pixels.begin() + (size_t)y*width + x1, x2 - x1 + 1, color);
+
+}
+
+void RasterImage::FillRect(Int_t x1, Int_t y1, Int_t x2, Int_t y2, UInt_t color){
+
+  /** Fills the rectangle between the pixels (\p x1, \p y1) and (\p x2, \p y2) **/
+
+  if (x1 > x2) std::swap(x1, x2);
+  if (y1 > y2) std::swap(y1, y2);
+
+  for (Int_t y = std::max(y1, clipY1); y <= std::min(y2, clipY2); y++) Span(x1, x2, y, color);
+
+}
+
+std::vector<Double_t> RasterImage::GetDashes(Style_t lstyle, Int_t lwidth){
+
+  /** Returns the dash pattern of line style \p lstyle as alternating lengths of
+      dashes and gaps in pixels, taken from gStyle as for the ROOT graphics.
+      Empty for solid lines. **/
+
+  std::vector<Double_t> dashes;
+  if (lstyle <= 1) return dashes;
+
+  std::istringstream pattern(gStyle->GetLineStyleString(lstyle));
+  Double_t length;
+  while (pattern >> length) dashes.push_back(std::max(length/4.*std::max(lwidth, 1), 1.));
+
+  if (dashes.size() % 2) dashes.push_back(dashes.back());
+  return dashes;
+
+}
+
+void RasterImage::Segment(Double_t x1, Double_t y1, Double_t x2, Double_t y2, UInt_t color, Int_t lwidth, const std::vector<Double_t>& dashes){
+
+  /** Draws a straight line of \p lwidth pixels between two pixel positions.
+      The line is clipped to the drawable region (Liang-Barsky) and then
+      walked along its major direction, drawing one span perpendicular to it
+      per step. The dash pattern still runs on over the clipped parts. **/
+
+  Double_t dx = x2 - x1, dy = y2 - y1;
+  Double_t length = TMath::Sqrt(dx*dx + dy*dy);
+
+  // the region is widened by the line width, so that the ends of wide lines are kept
+  Double_t t1 = 0, t2 = 1;
+  const Double_t p[4] = {-dx, dx, -dy, dy};
+  const Double_t q[4] = {x1 - (clipX1 - lwidth), (clipX2 + lwidth) - x1, y1 - (clipY1 - lwidth), (clipY2 + lwidth) - y1};
+  for (Int_t edge = 0; edge < 4 && t1 <= t2; edge++){
+    if (p[edge] == 0){
+      if (q[edge] < 0) t1 = 2;  // parallel to the edge and outside
+      continue;
+    }
+    Double_t t = q[edge]/p[edge];
+    if (p[edge] < 0) t1 = std::max(t1, t);
+    else t2 = std::min(t2, t);
+  }
+
+  if (t1 > t2){
+    dashPhase += length;
+    return;
+  }
+
+  dashPhase += t1*length;
+  x1 += dx*t1;
+  y1 += dy*t1;
+  dx *= t2 - t1;
+  dy *= t2 - t1;
+
+  Int_t nSteps = std::max(TMath::Nint(std::max(TMath::Abs(dx), TMath::Abs(dy))), 1);
+  Double_t stepLength = (t2 - t1)*length/nSteps;
+
+  Double_t period = 0;
+  for (Double_t dash : dashes) period += dash;
+
+  Int_t below = (lwidth - 1)/2, above = lwidth/2;
+  Bool_t horizontal = TMath::Abs(dx) >= TMath::Abs(dy);
+
+  for (Int_t step = 0; step <= nSteps; step++, dashPhase += stepLength){
+
+    if (period > 0){
+      Double_t phase = std::fmod(dashPhase, period);
+      size_t dash = 0;
+      while (phase >= dashes[dash]) phase -= dashes[dash++];
+      if (dash % 2) continue;
+    }
+
+    Int_t x = TMath::Nint(x1 + dx*step/nSteps);
+    Int_t y = TMath::Nint(y1 + dy*step/nSteps);
+
+    if (horizontal){
+      for (Int_t row = y - below; row <= y + above; row++) Span(x, x, row, color);
+    }
+    else Span(x - below, x + above, y, color);
+
+  }
+
+  dashPhase += (1 - t2)*length;
+
+}
+
+void RasterImage::DrawLine(Double_t x1, Double_t y1, Double_t x2, Double_t y2, UInt_t color, Double_t lwidth, Style_t lstyle){
+
+  /** Draws a line between two pixel positions **/
+
+  if (!std::isfinite(x1) || !std::isfinite(y1) || !std::isfinite(x2) || !std::isfinite(y2)) return;
+
+  Int_t pixels = std::max(TMath::Nint(lwidth*zoom), 1);
+  dashPhase = 0;
+  Segment(x1, y1, x2, y2, color, pixels, GetDashes(lstyle, pixels));
+
+}
+
+void RasterImage::DrawPolyLine(const std::vector<Double_t>& x, const std::vector<Double_t>& y, UInt_t color, Double_t lwidth, Style_t lstyle){
+
+  /** Draws a line through all pixel positions (\p x, \p y), the dash pattern
+      runs on over the corners. Points that cannot be shown interrupt the line. **/
+
+  Int_t pixels = std::max(TMath::Nint(lwidth*zoom), 1);
+  std::vector<Double_t> dashes = GetDashes(lstyle, pixels);
+  dashPhase = 0;
+
+  for (size_t point = 1; point < std::min(x.size(), y.size()); point++){
+    if (!std::isfinite(x[point-1]) || !std::isfinite(y[point-1]) || !std::isfinite(x[point]) || !std::isfinite(y[point])) continue;
+    Segment(x[point-1], y[point-1], x[point], y[point], color, pixels, dashes);
+  }
+
+}
+
+Bool_t RasterImage::InsidePolygon(const Double_t* polygon, Int_t nPoints, Double_t x, Double_t y){
+
+  /** Even-odd test wether (\p x, \p y) lies inside \p polygon, given as x, y pairs **/
+
+  Bool_t inside = kFALSE;
+
+  for (Int_t i = 0, j = nPoints - 1; i < nPoints; j = i++){
+    Double_t xi = polygon[2*i], yi = polygon[2*i+1], xj = polygon[2*j], yj = polygon[2*j+1];
+    if ((yi > y) != (yj > y) && x < (xj - xi)*(y - yi)/(yj - yi) + xi) inside = !inside;
+  }
+
+  return inside;
+
+}
+
+void RasterImage::DrawMarker(Double_t x, Double_t y, Style_t mstyle, Size_t msize, UInt_t color){
+
+  /** Draws a marker of style \p mstyle centered at the pixel position (\p x, \p y).
+      Marker size 1 corresponds to 8 pixels as in the ROOT graphics. The common
+      full and open markers are supported, all others are drawn as full circles. **/
+
+  if (!std::isfinite(x) || !std::isfinite(y)) return;
+
+  Int_t cx = ToPixel(x), cy = ToPixel(y);
+
+  // dots
+  if (mstyle == 1 || mstyle == 6 || mstyle == 7){
+    Int_t d = std::max(TMath::Nint(((mstyle == 1) ? 1 : (mstyle == 6) ? 2 : 3)*zoom), 1);
+    FillRect(cx - (d - 1)/2, cy - (d - 1)/2, cx + d/2, cy + d/2, color);
+    return;
+  }
+
+  Double_t r = std::max(4.*msize*zoom, 1.);
+  Int_t thickness = std::max(TMath::Nint(r/5.), 1);
+
+  // markers made of lines, the thickness is already zoomed
+  Double_t unzoomed = thickness/zoom;
+  if (mstyle == 2 || mstyle == 3 || mstyle == 5){
+    if (mstyle != 5){
+      DrawLine(cx - r, cy, cx + r, cy, color, unzoomed);
+      DrawLine(cx, cy - r, cx, cy + r, color, unzoomed);
+    }
+    if (mstyle != 2){
+      Double_t d = (mstyle == 3) ? 0.7*r : r;
+      DrawLine(cx - d, cy - d, cx + d, cy + d, color, unzoomed);
+      DrawLine(cx - d, cy + d, cx + d, cy - d, color, unzoomed);
+    }
+    return;
+  }
+
+  // area markers, given in units of the marker radius with Y pointing upwards
+  static const Double_t square[]   = {-0.8,-0.8, 0.8,-0.8, 0.8,0.8, -0.8,0.8};
+  static const Double_t triangle[] = {-1,-0.8, 1,-0.8, 0,1};
+  static const Double_t diamond[]  = {0,-1.2, 0.7,0, 0,1.2, -0.7,0};
+  static const Double_t cross[]    = {-0.3,-1, 0.3,-1, 0.3,-0.3, 1,-0.3, 1,0.3, 0.3,0.3, 0.3,1, -0.3,1, -0.3,0.3, -1,0.3, -1,-0.3, -0.3,-0.3};
+  static const Double_t star[]     = {0,1, 0.22,0.31, 0.95,0.31, 0.36,-0.12, 0.59,-0.81, 0,-0.38, -0.59,-0.81, -0.36,-0.12, -0.95,0.31, -0.22,0.31};
+
+  const Double_t* polygon = nullptr;
+  Int_t nPoints = 0;
+  Bool_t open = kFALSE, flip = kFALSE;
+
+  switch (mstyle){
+    case 21: case 25:           polygon = square;   nPoints = 4;  open = (mstyle == 25); break;
+    case 22: case 26:           polygon = triangle; nPoints = 3;  open = (mstyle == 26); break;
+    case 23: case 32:           polygon = triangle; nPoints = 3;  open = (mstyle == 32); flip = kTRUE; break;
+    case 33: case 27:           polygon = diamond;  nPoints = 4;  open = (mstyle == 27); break;
+    case 34: case 28:           polygon = cross;    nPoints = 12; open = (mstyle == 28); break;
+    case 29: case 30:           polygon = star;     nPoints = 10; open = (mstyle == 30); break;
+    case 4: case 24:            open = kTRUE; break;
+    default:                    break;
+  }
+
+  // open polygons are outlined, which keeps the outline closed for small markers
+  if (open && polygon){
+    Double_t sign = flip ? 1 : -1;
+    for (Int_t i = 0, j = nPoints - 1; i < nPoints; j = i++)
+      DrawLine(cx + polygon[2*j]*r, cy + sign*polygon[2*j+1]*r, cx + polygon[2*i]*r, cy + sign*polygon[2*i+1]*r, color, unzoomed);
+    return;
+  }
+
+  Double_t inner = open ? std::max(1. - thickness/r, 0.) : 0.;
+  Int_t extent = TMath::CeilNint(1.3*r);
+
+  for (Int_t row = -extent; row <= extent; row++){
+
+    Double_t v = (flip ? row : -row)/r;
+    Int_t first = 1, last = 0;
+
+    for (Int_t col = -extent; col <= extent + 1; col++){
+
+      Double_t u = col/r;
+      Bool_t inside = (col <= extent) && (polygon ? InsidePolygon(polygon, nPoints, u, v) : u*u + v*v <= 1.)
+                      && !(open && u*u + v*v < inner*inner);
+
+      if (inside){
+        if (first > last){ first = col; last = col; }
+        else last = col;
+      }
+      else if (first <= last){
+        Span(cx + first, cx + last, cy + row, color);
+        first = 1; last = 0;
+      }
+
+    }
+
+  }
+
+}
+
+void RasterImage::DrawText(Int_t x, Int_t y, const std::string& text, UInt_t color, Int_t scale, Int_t align, Bool_t vertical){
+
+  /** Draws \p text with the built-in font, every font pixel becomes a square
+      of \p scale pixels. The alignment \p align follows the ROOT convention
+      (10*horizontal + vertical, 1 = left/bottom, 2 = center, 3 = right/top).
+      Vertical text is rotated counter-clockwise like the title of a Y-axis. **/
+
+  scale = std::max(scale, 1);
+  Int_t w = GetTextWidth(text, scale), h = GetTextHeight(scale);
+
+  Int_t hAlign = align/10, vAlign = align%10;
+  Int_t along  = (hAlign == 2) ? -w/2 : (hAlign == 3) ? -w : 0;   // offset of the start of the text along the writing direction
+  Int_t across = (vAlign == 2) ? -h/2 : (vAlign == 1) ? -h : 0;   // offset of the top of the glyphs perpendicular to it
+
+  for (size_t index = 0; index < text.size(); index++){
+
+    Int_t character = (UChar_t)text[index];
+    const UChar_t* glyph = glyphs[(character >= 32 && character < 127) ? character - 32 : '?' - 32];
+
+    for (Int_t col = 0; col < 5; col++){
+      for (Int_t row = 0; row < 7; row++){
+
+        if (!(glyph[col] & (1 << row))) continue;
+
+        Int_t a = along + (6*index + col)*scale;
+        Int_t b = across + row*scale;
+
+        if (vertical) FillRect(x + b, y - a - scale + 1, x + b + scale - 1, y - a, color);
+        else FillRect(x + a, y + b, x + a + scale - 1, y + b + scale - 1, color);
+
+      }
+    }
+
+  }
+
+}
+
+UInt_t RasterImage::GetColor(Color_t color){
+
+  /** Converts the ROOT color index \p color to a packed RGBA value **/
+
+  TColor* rootColor = gROOT->GetColor(color);
+  if (!rootColor) return 0xff000000;
+
+  UInt_t r = TMath::Nint(255*rootColor->GetRed());
+  UInt_t g = TMath::Nint(255*rootColor->GetGreen());
+  UInt_t b = TMath::Nint(255*rootColor->GetBlue());
+
+  return r | (g << 8) | (b << 16) | 0xff000000;
+
+}
+
+std::string RasterImage::PlainText(TString latex){
+
+  /** Reduces the TLatex markup in \p latex to plain text: font commands
+      (#it, #bf, #font[..], ...) and braces are removed, greek letters and
+      other commands are spelled out and subscripts are written inline **/
+
+  static const std::set<std::string> dropped = {"it", "bf", "rm", "mathrm", "font", "color", "scale", "kern", "lower", "bar", "hat", "tilde", "vec", "dot", "splitline"};
+
+  std::string plain;
+  std::string text = latex.Data();
+
+  for (size_t pos = 0; pos < text.size(); pos++){
+
+    char c = text[pos];
+
+    if (c == '#'){
+      size_t end = pos + 1;
+      while (end < text.size() && std::isalpha((UChar_t)text[end])) end++;
+      std::string command = text.substr(pos + 1, end - pos - 1);
+      if (end < text.size() && text[end] == '[' && dropped.count(command)) end = text.find(']', end) + 1;
+      if (!dropped.count(command)) plain += command;
+      pos = (end == 0) ? text.size() : end - 1;
+    }
+    else if (c == '{' || c == '}' || c == '_') continue;
+    else plain += c;
+
+  }
+
+  return plain;
+
+}
+
+Bool_t RasterImage::WritePNG(TString filename) const {
+
+  /** Writes the image as 8 bit RGBA PNG. The rows are stored unfiltered and
+      compressed for speed rather than size, which suits the large uniform
+      areas of plots. **/
+
+  std::vector<UChar_t> raw((4*(size_t)width + 1)*height);
+
+  size_t out = 0;
+  for (UInt_t row = 0; row < height; row++){
+    raw[out++] = 0; // filter type none
+    const UInt_t* pixel = pixels.data() + (size_t)row*width;
+    for (UInt_t col = 0; col < width; col++){
+      raw[out++] = pixel[col];
+      raw[out++] = pixel[col] >> 8;
+      raw[out++] = pixel[col] >> 16;
+      raw[out++] = pixel[col] >> 24;
+    }
+  }
+
+  uLongf size = compressBound(raw.size());
+  std::vector<UChar_t> compressed(size);
+  if (compress2(compressed.data(), &size, raw.data(), raw.size(), Z_BEST_SPEED) != Z_OK){
+    std::cout << "\033[1;31mERROR:\033[0m Image " << filename << " could not be compressed!" << std::endl;
+    return kFALSE;
+  }
+
+  std::ofstream file(filename.Data(), std::ios::binary);
+  if (!file){
+    std::cout << "\033[1;31mERROR:\033[0m File " << filename << " could not be opened!" << std::endl;
+    return kFALSE;
+  }
+
+  auto bigEndian = [](UChar_t* bytes, UInt_t value){
+    bytes[0] = value >> 24; bytes[1] = value >> 16; bytes[2] = value >> 8; bytes[3] = value;
+  };
+
+  auto writeChunk = [&](const char* type, const UChar_t* data, UInt_t length){
+    UChar_t bytes[4];
+    bigEndian(bytes, length);
+    file.write((const char*)bytes, 4);
+    file.write(type, 4);
+    if (length) file.write((const char*)data, length);
+    uLong crc = crc32(0L, (const Bytef*)type, 4);
+    if (length) crc = crc32(crc, data, length);
+    bigEndian(bytes, crc);
+    file.write((const char*)bytes, 4);
+  };
+
+  static const UChar_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  file.write((const char*)signature, 8);
+
+  UChar_t header[13] = {0};
+  bigEndian(header, width);
+  bigEndian(header + 4, height);
+  header[8] = 8;  // bit depth
+  header[9] = 6;  // color type RGBA
+  writeChunk("IHDR", header, 13);
+  writeChunk("IDAT", compressed.data(), size);
+  writeChunk("IEND", nullptr, 0);
+
+  return file.good();
+
+}
+
+// ----------------------------------------------------------------------------
+//                            RASTER PAINTER CLASS
+// ----------------------------------------------------------------------------
+
+//! Paints ROOT objects into a RasterImage
+
+class RasterPainter
+{
+
+public:
+
+  static Bool_t IsSupported(TObject* obj);
+  static Int_t GetTextScale(const RasterImage& image, Style_t font, Float_t size);
+
+  static void Paint(RasterImage& image, TObject* obj, TString opt);
+  static void PaintAxes(RasterImage& image, TString xTitle, TString yTitle, Float_t xOffset, Float_t yOffset, Int_t scale, Bool_t xLabels = kTRUE);
+  static void PaintLegend(RasterImage& image, TLegend* legend);
+
+private:
+
+  static void PaintHistogram(RasterImage& image, TH1* hist, TString opt);
+  static void PaintGraph(RasterImage& image, TGraph* graph, TString opt);
+  static void PaintFunction(RasterImage& image, TF1* func);
+  static std::vector<Double_t> GetTicks(Double_t low, Double_t up, Bool_t log, Bool_t minor);
+
+};
+
+// ---- Member Functions ------------------------------------------------------
+
+Bool_t RasterPainter::IsSupported(TObject* obj){
+
+  /** Returns wether \p obj can be painted by the raster backend **/
+
+  if (!obj) return kFALSE;
+  if (obj->InheritsFrom("TH2") || obj->InheritsFrom("TF2")) return kFALSE;
+
+  return obj->InheritsFrom("TH1") || obj->InheritsFrom("TGraph") || obj->InheritsFrom("TF1")
+      || obj->InheritsFrom("TLegend") || obj->InheritsFrom("TLine") || obj->InheritsFrom("TMarker");
+
+}
+
+Int_t RasterPainter::GetTextScale(const RasterImage& image, Style_t font, Float_t size){
+
+  /** Returns the scale of the built-in font closest to the text size \p size
+      of \p font (pixels for precision 3, fraction of the image height otherwise) **/
+
+  Float_t pixels = (font%10 == 3) ? size*image.GetZoom() : size*image.GetHeight();
+  return std::max(TMath::Nint(pixels/9.), 1);
+
+}
+
+void RasterPainter::Paint(RasterImage& image, TObject* obj, TString opt){
+
+  /** Paints \p obj with draw option \p opt inside the frame of \p image **/
+
+  opt.ToUpper();
+  opt.ReplaceAll("SAME", "");
+  opt.ReplaceAll("PMC", "");
+  opt.ReplaceAll("PLC", "");
+  opt.ReplaceAll("PFC", "");
+
+  image.SetClip(kTRUE);
+
+  if (obj->InheritsFrom("TH1")) PaintHistogram(image, (TH1*)obj, opt);
+  else if (obj->InheritsFrom("TGraph")) PaintGraph(image, (TGraph*)obj, opt);
+  else if (obj->InheritsFrom("TF1")) PaintFunction(image, (TF1*)obj);
+  else if (obj->InheritsFrom("TLine")){
+    TLine* line = (TLine*)obj;
+    image.DrawLine(image.ToX(line->GetX1()), image.ToY(line->GetY1()), image.ToX(line->GetX2()), image.ToY(line->GetY2()),
+                   RasterImage::GetColor(line->GetLineColor()), line->GetLineWidth(), line->GetLineStyle());
+  }
+  else if (obj->InheritsFrom("TMarker")){
+    TMarker* marker = (TMarker*)obj;
+    image.DrawMarker(image.ToX(marker->GetX()), image.ToY(marker->GetY()), marker->GetMarkerStyle(), marker->GetMarkerSize(),
+                     RasterImage::GetColor(marker->GetMarkerColor()));
+  }
+  else if (obj->InheritsFrom("TLegend")) PaintLegend(image, (TLegend*)obj);
+
+  image.SetClip(kFALSE);
+
+}
+
+void RasterPainter::PaintHistogram(RasterImage& image, TH1* hist, TString opt){
+
+  /** Paints a one-dimensional histogram as steps (HIST), error bars (E),
+      markers (P) and/or a line through the bin centers (L, C). Without any of
+      these options histograms with errors are drawn with error bars and markers,
+      all others as steps, like in the ROOT graphics. **/
+
+  Bool_t steps   = opt.Contains("HIST");
+  Bool_t errors  = !steps && opt.Contains("E");
+  Bool_t markers = !steps && (opt.Contains("P") || errors);
+  Bool_t line    = !steps && (opt.Contains("L") || opt.Contains("C"));
+
+  if (!steps && !errors && !markers && !line){
+    if (hist->GetSumw2N()) errors = markers = kTRUE;
+    else steps = kTRUE;
+  }
+
+  TAxis* axis = hist->GetXaxis();
+  Int_t nBins = axis->GetNbins();
+
+  UInt_t lineColor = RasterImage::GetColor(hist->GetLineColor());
+  UInt_t markerColor = RasterImage::GetColor(hist->GetMarkerColor());
+  Int_t lwidth = hist->GetLineWidth();
+  Double_t errorX = gStyle->GetErrorX();
+
+  if (steps){
+
+    std::vector<Double_t> x, y;
+    x.reserve(2*nBins + 2);
+    y.reserve(2*nBins + 2);
+
+    Bool_t fill = hist->GetFillStyle() == 1001 && hist->GetFillColor() != 0;
+    UInt_t fillColor = RasterImage::GetColor(hist->GetFillColor());
+    Double_t base = std::min(std::max(image.ToY(0), (Double_t)image.GetFrameY1()), (Double_t)image.GetFrameY2());
+    if (!std::isfinite(base)) base = image.GetFrameY2();
+
+    for (Int_t bin = 1; bin <= nBins; bin++){
+      Double_t low = image.ToX(axis->GetBinLowEdge(bin)), up = image.ToX(axis->GetBinUpEdge(bin));
+      Double_t content = image.ToY(hist->GetBinContent(bin));
+      if (!std::isfinite(content)) content = image.GetFrameY2() + lwidth*image.GetZoom();
+      if (fill && std::isfinite(low) && std::isfinite(up)) image.FillRect(image.ToPixel(low), image.ToPixel(content), image.ToPixel(up), image.ToPixel(base), fillColor);
+      x.push_back(low); y.push_back(content);
+      x.push_back(up);  y.push_back(content);
+    }
+
+    image.DrawPolyLine(x, y, lineColor, lwidth, hist->GetLineStyle());
+
+  }
+
+  std::vector<Double_t> x, y;
+  if (line){
+    x.reserve(nBins);
+    y.reserve(nBins);
+  }
+
+  for (Int_t bin = 1; bin <= nBins; bin++){
+
+    Double_t center = axis->GetBinCenter(bin), content = hist->GetBinContent(bin), error = hist->GetBinError(bin);
+
+    if (line){
+      x.push_back(image.ToX(center));
+      y.push_back(image.ToY(content));
+    }
+
+    if (!errors && !markers) continue;
+    if (content == 0 && error == 0) continue; // empty bins are skipped as in the ROOT graphics
+
+    Double_t px = image.ToX(center), py = image.ToY(content);
+
+    if (errors){
+      Double_t halfWidth = errorX*axis->GetBinWidth(bin);
+      image.DrawLine(px, image.ToY(content - error), px, image.ToY(content + error), lineColor, lwidth);
+      if (halfWidth > 0) image.DrawLine(image.ToX(center - halfWidth), py, image.ToX(center + halfWidth), py, lineColor, lwidth);
+    }
+
+    if (markers) image.DrawMarker(px, py, hist->GetMarkerStyle(), hist->GetMarkerSize(), markerColor);
+
+  }
+
+  if (line) image.DrawPolyLine(x, y, lineColor, lwidth, hist->GetLineStyle());
+
+}
+
+void RasterPainter::PaintGraph(RasterImage& image, TGraph* graph, TString opt){
+
+  /** Paints a graph with markers (P) and/or lines (L, C), graphs with errors
+      additionally get error bars unless option X is given **/
+
+  Bool_t markers = opt.Contains("P");
+  Bool_t line    = opt.Contains("L") || opt.Contains("C");
+  if (!markers && !line) markers = kTRUE;
+
+  Bool_t errors = (graph->InheritsFrom("TGraphErrors") || graph->InheritsFrom("TGraphAsymmErrors")) && !opt.Contains("X");
+
+  Int_t nPoints = graph->GetN();
+  Double_t* gx = graph->GetX();
+  Double_t* gy = graph->GetY();
+
+  UInt_t lineColor = RasterImage::GetColor(graph->GetLineColor());
+  UInt_t markerColor = RasterImage::GetColor(graph->GetMarkerColor());
+  Int_t lwidth = graph->GetLineWidth();
+
+  std::vector<Double_t> x(nPoints), y(nPoints);
+  for (Int_t point = 0; point < nPoints; point++){
+    x[point] = image.ToX(gx[point]);
+    y[point] = image.ToY(gy[point]);
+  }
+
+  if (line) image.DrawPolyLine(x, y, lineColor, lwidth, graph->GetLineStyle());
+
+  for (Int_t point = 0; point < nPoints; point++){
+
+    if (errors){
+      Double_t yLow = graph->GetErrorYlow(point), yHigh = graph->GetErrorYhigh(point);
+      Double_t xLow = graph->GetErrorXlow(point), xHigh = graph->GetErrorXhigh(point);
+      if (yLow > 0 || yHigh > 0) image.DrawLine(x[point], image.ToY(gy[point] - yLow), x[point], image.ToY(gy[point] + yHigh), lineColor, lwidth);
+      if (xLow > 0 || xHigh > 0) image.DrawLine(image.ToX(gx[point] - xLow), y[point], image.ToX(gx[point] + xHigh), y[point], lineColor, lwidth);
+    }
+
+    if (markers) image.DrawMarker(x[point], y[point], graph->GetMarkerStyle(), graph->GetMarkerSize(), markerColor);
+
+  }
+
+}
+
+void RasterPainter::PaintFunction(RasterImage& image, TF1* func){
+
+  /** Paints a function as line, sampled at its number of points within the frame.
+      With function sampling (cf. Plot::SetFunctionSampling) the cached samples
+      are painted instead. **/
+
+  if (FunctionSampler::IsEnabled()){
+    TGraph* sampled = FunctionSampler::Sample(func, image.GetLogX());
+    std::vector<Double_t> x(sampled->GetN()), y(sampled->GetN());
+    for (Int_t point = 0; point < sampled->GetN(); point++){
+      x[point] = image.ToX(sampled->GetX()[point]);
+      y[point] = image.ToY(sampled->GetY()[point]);
+    }
+    image.DrawPolyLine(x, y, RasterImage::GetColor(func->GetLineColor()), func->GetLineWidth(), func->GetLineStyle());
+    return;
+  }
+
+  Double_t xLow, xUp;
+  func->GetRange(xLow, xUp);
+
+  Int_t nPoints = std::max(func->GetNpx(), 2);
+  std::vector<Double_t> x(nPoints + 1), y(nPoints + 1);
+
+  for (Int_t point = 0; point <= nPoints; point++){
+    Double_t value = xLow + (xUp - xLow)*point/nPoints;
+    x[point] = image.ToX(value);
+    y[point] = image.ToY(func->Eval(value));
+  }
+
+  image.DrawPolyLine(x, y, RasterImage::GetColor(func->GetLineColor()), func->GetLineWidth(), func->GetLineStyle());
+
+}
+
+std::vector<Double_t> RasterPainter::GetTicks(Double_t low, Double_t up, Bool_t log, Bool_t minor){
+
+  /** Returns the positions of the (\p minor or major) ticks of an axis from
+      \p low to \p up, with decades on logarithmic axes and steps of 1, 2 or 5
+      (cf. Plot::GetAxisLabels) on linear ones **/
+
+  std::vector<Double_t> ticks;
+
+  if (log && low > 0 && up > low){
+    for (Int_t exp = TMath::FloorNint(TMath::Log10(low)); exp <= TMath::CeilNint(TMath::Log10(up)); exp++){
+      for (Int_t digit = minor ? 2 : 1; digit <= (minor ? 9 : 1); digit++){
+        Double_t tick = digit*TMath::Power(10, exp);
+        if (tick >= low*(1 - 1E-9) && tick <= up*(1 + 1E-9)) ticks.push_back(tick);
+      }
+    }
+    return ticks;
+  }
+
+  Double_t raw = TMath::Abs(up - low)/10;
+  if (!(raw > 0)) return ticks;
+
+  Double_t magnitude = TMath::Power(10, TMath::Floor(TMath::Log10(raw)));
+  Double_t step = magnitude*((raw <= magnitude) ? 1 : (raw <= 2*magnitude) ? 2 : (raw <= 5*magnitude) ? 5 : 10);
+  if (minor) step /= 5;
+
+  for (Double_t tick = TMath::Ceil(std::min(low, up)/step); tick*step <= std::max(low, up) + 1E-9*step; tick++){
+    ticks.push_back(TMath::Abs(tick*step) < 1E-9*step ? 0 : tick*step);
+  }
+
+  return ticks;
+
+}
+
+void RasterPainter::PaintAxes(RasterImage& image, TString xTitle, TString yTitle, Float_t xOffset, Float_t yOffset, Int_t scale, Bool_t xLabels){
+
+  /** Paints the frame with ticks on all four sides, the labels of the lower and
+      left axis (the X-labels only if \p xLabels) and the axis titles, placed
+      according to the title offsets **/
+
+  image.SetClip(kFALSE);
+
+  Int_t x1 = image.GetFrameX1(), x2 = image.GetFrameX2(), y1 = image.GetFrameY1(), y2 = image.GetFrameY2();
+  UInt_t black = RasterImage::GetColor(kBlack);
+  Int_t t = std::max(TMath::Nint(image.GetZoom()), 1) - 1;
+
+  image.FillRect(x1, y1, x2, y1 + t, black);
+  image.FillRect(x1, y2 - t, x2, y2, black);
+  image.FillRect(x1, y1, x1 + t, y2, black);
+  image.FillRect(x2 - t, y1, x2, y2, black);
+
+  Double_t xLow = image.GetXlow(), xUp = image.GetXup(), yLow = image.GetYlow(), yUp = image.GetYup();
+  Bool_t xLog = image.GetLogX(), yLog = image.GetLogY();
+
+  Int_t xTick = TMath::Nint(0.03*(y2 - y1)), yTick = TMath::Nint(0.03*(x2 - x1));
+  Int_t gap = std::max(scale*3, 2);
+  Int_t textHeight = RasterImage::GetTextHeight(scale);
+
+  for (Int_t minor = 1; minor >= 0; minor--){
+
+    for (Double_t tick : GetTicks(xLow, xUp, xLog, minor)){
+      Int_t px = TMath::Nint(image.ToX(tick)), length = minor ? xTick/2 : xTick;
+      image.FillRect(px, y2 - length, px + t, y2, black);
+      image.FillRect(px, y1, px + t, y1 + length, black);
+      if (!minor && xLabels) image.DrawText(px, y2 + gap, Form("%g", tick), black, scale, 23);
+    }
+
+  }
+
+  Int_t labelWidth = 0;
+
+  for (Int_t minor = 1; minor >= 0; minor--){
+
+    for (Double_t tick : GetTicks(yLow, yUp, yLog, minor)){
+      Int_t py = TMath::Nint(image.ToY(tick)), length = minor ? yTick/2 : yTick;
+      image.FillRect(x1, py - t, x1 + length, py, black);
+      image.FillRect(x2 - length, py - t, x2, py, black);
+      if (minor) continue;
+      std::string text = Form("%g", tick);
+      labelWidth = std::max(labelWidth, RasterImage::GetTextWidth(text, scale));
+      image.DrawText(x1 - gap, py, text, black, scale, 32);
+    }
+
+  }
+
+  // titles are aligned to the upper/right end of the axes as in ROOT, the offsets scale their distance
+  Int_t xDistance = std::max(TMath::Nint(xOffset*1.6*textHeight), (xLabels ? textHeight : 0) + 2*gap);
+  Int_t yDistance = std::max(TMath::Nint(yOffset*1.6*textHeight), labelWidth + 2*gap);
+
+  image.DrawText(x2, y2 + xDistance, RasterImage::PlainText(xTitle), black, scale, 33);
+  image.DrawText(x1 - yDistance - textHeight, y1, RasterImage::PlainText(yTitle), black, scale, 31, kTRUE);
+
+}
+
+void RasterPainter::PaintLegend(RasterImage& image, TLegend* legend){
+
+  /** Paints a legend at its position in the pad, with the symbols of its
+      entries (line, marker, error bar, fill) and their labels. The attributes
+      are taken from the objects of the entries, like in the ROOT graphics. **/
+
+  image.SetClip(kFALSE);
+
+  Int_t w = image.GetWidth(), h = image.GetHeight();
+  Int_t x1 = TMath::Nint(legend->GetX1()*w), x2 = TMath::Nint(legend->GetX2()*w);
+  Int_t y1 = TMath::Nint((1 - legend->GetY2())*h), y2 = TMath::Nint((1 - legend->GetY1())*h);
+
+  if (legend->GetFillStyle() == 1001) image.FillRect(x1, y1, x2, y2, RasterImage::GetColor(legend->GetFillColor()));
+  if (legend->GetBorderSize() > 0){
+    UInt_t border = RasterImage::GetColor(legend->GetLineColor());
+    Int_t t = std::max(TMath::Nint(image.GetZoom()), 1) - 1;
+    image.FillRect(x1, y1, x2, y1 + t, border);
+    image.FillRect(x1, y2 - t, x2, y2, border);
+    image.FillRect(x1, y1, x1 + t, y2, border);
+    image.FillRect(x2 - t, y1, x2, y2, border);
+  }
+
+  TList* entries = legend->GetListOfPrimitives();
+  if (!entries || !entries->GetSize()) return;
+
+  Int_t nColumns = std::max(legend->GetNColumns(), 1);
+  Int_t scale = GetTextScale(image, legend->GetTextFont(), legend->GetTextSize());
+  UInt_t textColor = RasterImage::GetColor(legend->GetTextColor());
+
+  // the header occupies a row of its own, all other entries are filled in row by row
+  Int_t nHeaders = 0, nEntries = 0;
+  TIter iEntries(entries);
+  while (TLegendEntry* entry = (TLegendEntry*)iEntries()){
+    if (TString(entry->GetOption()).Contains("h")) nHeaders++;
+    else nEntries++;
+  }
+
+  Int_t nRows = nHeaders + (nEntries + nColumns - 1)/nColumns;
+  Double_t rowHeight = (Double_t)(y2 - y1)/nRows;
+  Double_t colWidth  = (Double_t)(x2 - x1)/nColumns;
+  Double_t margin    = legend->GetMargin()*colWidth;
+
+  Int_t row = 0, index = 0;
+  iEntries.Reset();
+
+  while (TLegendEntry* entry = (TLegendEntry*)iEntries()){
+
+    TString opt = entry->GetOption();
+    std::string label = RasterImage::PlainText(entry->GetLabel());
+
+    if (opt.Contains("h")){
+      image.DrawText(x1 + TMath::Nint(0.05*(x2 - x1)), TMath::Nint(y1 + (row + 0.5)*rowHeight), label, textColor, scale, 12);
+      row++;
+      continue;
+    }
+
+    Int_t entryRow = row + index/nColumns, entryCol = index%nColumns;
+    index++;
+
+    Double_t left = x1 + entryCol*colWidth;
+    Double_t cy = y1 + (entryRow + 0.5)*rowHeight;
+    Double_t cx = left + margin/2;
+
+    TObject* obj = entry->GetObject();
+    TAttLine*   lineAtt   = dynamic_cast<TAttLine*>(obj)   ? dynamic_cast<TAttLine*>(obj)   : (TAttLine*)entry;
+    TAttMarker* markerAtt = dynamic_cast<TAttMarker*>(obj) ? dynamic_cast<TAttMarker*>(obj) : (TAttMarker*)entry;
+    TAttFill*   fillAtt   = dynamic_cast<TAttFill*>(obj)   ? dynamic_cast<TAttFill*>(obj)   : (TAttFill*)entry;
+
+    opt.ToLower();
+
+    if (opt.Contains("f") && fillAtt->GetFillStyle() != 0){
+      image.FillRect(TMath::Nint(left + 0.1*margin), TMath::Nint(cy - 0.35*rowHeight), TMath::Nint(left + 0.9*margin), TMath::Nint(cy + 0.35*rowHeight),
+                     RasterImage::GetColor(fillAtt->GetFillColor()));
+    }
+    if (opt.Contains("l")){
+      image.DrawLine(left + 0.1*margin, cy, left + 0.9*margin, cy, RasterImage::GetColor(lineAtt->GetLineColor()),
+                     lineAtt->GetLineWidth(), lineAtt->GetLineStyle());
+    }
+    if (opt.Contains("e")){
+      image.DrawLine(cx, cy - 0.4*rowHeight, cx, cy + 0.4*rowHeight, RasterImage::GetColor(lineAtt->GetLineColor()), lineAtt->GetLineWidth());
+    }
+    if (opt.Contains("p")){
+      image.DrawMarker(cx, cy, markerAtt->GetMarkerStyle(), markerAtt->GetMarkerSize(), RasterImage::GetColor(markerAtt->GetMarkerColor()));
+    }
+
+    image.DrawText(TMath::Nint(left + margin), TMath::Nint(cy), label, textColor, scale, 12);
+
+  }
+
+}
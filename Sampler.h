@@ -0,0 +1,204 @@
+// ~~ SAMPLER ~~
+
+// ----------------------------------------------------------------------------
+//
+// This file contains the function sampler, which evaluates functions that
+// are drawn on top of a plot once and keeps the points as a graph. ROOT
+// evaluates a TF1 at all of its points every time it is painted, which is
+// expensive for e.g. theory curves based on numerical integrals and adds up
+// when the same plot is written in several formats.
+// The function is evaluated in one pass on a regular grid of its number of
+// points, intervals where the function is curved are then refined by
+// bisection. The graph is reused until the formula, parameters, range or
+// number of points of the function change, and is then updated in place, so
+// pads that already show it are repainted with the new curve.
+// The sampler keeps the graphs of the most recently sampled functions only
+// and is not thread-safe: all functions have to be sampled from one thread.
+//
+// ----------------------------------------------------------------------------
+
+#define SAMPLER_H
+
+// ----------------------------------------------------------------------------
+//                           FUNCTION SAMPLER CLASS
+// ----------------------------------------------------------------------------
+
+//! Class for sampling functions once and drawing them as graphs
+
+class FunctionSampler
+{
+
+public:
+
+  static TGraph* Sample(TF1* function, Bool_t logX = kFALSE);
+  static void Clear() {samples.clear();}  //!< Deletes all sampled graphs
+
+  static void SetEnabled(Bool_t use = kTRUE) {enabled = use;}         //!< Toggle wether functions in plot arrays are drawn from their samples
+  static void SetTolerance(Double_t tol) {tolerance = tol;}            //!< Set the largest deviation from a straight line, relative to the range of the function
+  static void SetMaxDepth(Int_t depth) {maxDepth = depth;}             //!< Set how often an interval is bisected at most
+  static void SetMaxEntries(UInt_t entries) {maxEntries = std::max(entries, 1u);} //!< Set the number of functions whose graphs are kept
+  static void Forget(TF1* function) {samples.erase(function);}        //!< Deletes the graph of \p function, e.g. before the function is deleted
+  static Bool_t IsEnabled() {return enabled;}                          //!< Are functions in plot arrays drawn from their samples?
+  static Long64_t GetNevaluations() {return nEvaluations;}             //!< Number of evaluations of all functions sampled so far
+  static UInt_t GetNentries() {return samples.size();}                 //!< Number of functions whose graphs are kept
+
+private:
+
+  //! Sampled graph of one function
+  struct Samples {
+    ULong64_t fingerprint {0};          //!< Fingerprint of function and sampling settings
+    ULong64_t lastUse {0};              //!< Value of the use counter at the last request
+    std::unique_ptr<TGraph> graph;      //!< Sampled points
+  };
+
+  static std::map<TF1*, Samples> samples; //!< Sampled graph of the most recently used functions
+  static Bool_t   enabled;                //!< Are functions in plot arrays drawn from their samples?
+  static Double_t tolerance;              //!< Largest deviation from a straight line, relative to the range of the function
+  static Int_t    maxDepth;               //!< Number of bisections of an interval at most
+  static UInt_t   maxEntries;             //!< Number of functions whose graphs are kept at most
+  static ULong64_t uses;                  //!< Number of requests so far, orders the entries by their last use
+  static Long64_t nEvaluations;           //!< Number of evaluations so far
+
+};
+
+// ---- Static Member Variables -----------------------------------------------
+
+std::map<TF1*, FunctionSampler::Samples> FunctionSampler::samples;
+Bool_t   FunctionSampler::enabled {kFALSE};
+Double_t FunctionSampler::tolerance {1e-3};
+Int_t    FunctionSampler::maxDepth {4};
+UInt_t   FunctionSampler::maxEntries {256};
+ULong64_t FunctionSampler::uses {0};
+Long64_t FunctionSampler::nEvaluations {0};
+
+// ---- Member Functions ------------------------------------------------------
+
+TGraph* FunctionSampler::Sample(TF1* function, Bool_t logX){
+
+  /** Returns the graph of \p function over its range, sampled equidistantly
+      (logarithmically for \p logX) at its number of points and refined where
+      a straight line between two points deviates from the function by more
+      than the tolerance. The graph belongs to the sampler and takes over the
+      line, fill and marker attributes of the function. It stays the same object
+      while the function is kept, but is deleted once more than SetMaxEntries
+      other functions were sampled since its last use. **/
+
+  Double_t xLow, xUp;
+  function->GetRange(xLow, xUp);
+  logX = logX && xLow > 0;
+  Int_t nPoints = std::max(function->GetNpx(), 2);
+
+  ULong64_t fingerprint = HashObject(function);
+  fingerprint = (fingerprint ^ std::hash<std::string>()(std::string(function->GetExpFormula().Data())))*1099511628211ULL;
+  for (Double_t setting : {xLow, xUp, (Double_t)nPoints, (Double_t)logX, tolerance, (Double_t)maxDepth}){
+    ULong64_t bits;
+    std::memcpy(&bits, &setting, sizeof(bits));
+    fingerprint = (fingerprint ^ bits)*1099511628211ULL;
+  }
+
+  if (!samples.count(function) && samples.size() >= maxEntries){
+    auto oldest = std::min_element(samples.begin(), samples.end(), [](const auto& a, const auto& b){return a.second.lastUse < b.second.lastUse;});
+    samples.erase(oldest);
+  }
+
+  Samples& sampled = samples[function];
+  sampled.lastUse = ++uses;
+
+  if (!sampled.graph || sampled.fingerprint != fingerprint){
+
+    // points are placed in t, which is log10(x) for logarithmic sampling
+    const Double_t* params = function->GetParameters();
+    auto evaluate = [&](Double_t t){
+      Double_t x = logX ? TMath::Power(10, t) : t;
+      nEvaluations++;
+      return function->EvalPar(&x, params);
+    };
+
+    Double_t tLow = logX ? TMath::Log10(xLow) : xLow;
+    Double_t tUp  = logX ? TMath::Log10(xUp) : xUp;
+
+    std::vector<Double_t> t(nPoints + 1), y(nPoints + 1);
+    for (Int_t point = 0; point <= nPoints; point++){
+      t[point] = tLow + (tUp - tLow)*point/nPoints;
+      y[point] = evaluate(t[point]);
+    }
+
+    Double_t yMin = DBL_MAX, yMax = -DBL_MAX;
+    for (Double_t value : y){
+      if (!std::isfinite(value)) continue;
+      yMin = std::min(yMin, value);
+      yMax = std::max(yMax, value);
+    }
+    Double_t limit = tolerance*(yMax - yMin);
+
+    // intervals next to points with a large second difference are bisected first
+    std::vector<Bool_t> refine(nPoints, kFALSE);
+    for (Int_t point = 1; point < nPoints; point++){
+      if (std::abs(y[point - 1] - 2*y[point] + y[point + 1])/2 <= limit) continue;
+      refine[point - 1] = refine[point] = kTRUE;
+    }
+
+    for (Int_t depth = 0; depth < maxDepth; depth++){
+
+      std::vector<Double_t> tRefined, yRefined;
+      std::vector<Bool_t> again;
+      Bool_t curved = kFALSE;
+
+      for (UInt_t interval = 0; interval + 1 < t.size(); interval++){
+
+        tRefined.push_back(t[interval]);
+        yRefined.push_back(y[interval]);
+
+        if (!refine[interval]){
+          again.push_back(kFALSE);
+          continue;
+        }
+
+        Double_t tMiddle = (t[interval] + t[interval + 1])/2;
+        Double_t yMiddle = evaluate(tMiddle);
+        Bool_t deviates = !(std::abs(yMiddle - (y[interval] + y[interval + 1])/2) <= limit);
+
+        tRefined.push_back(tMiddle);
+        yRefined.push_back(yMiddle);
+        again.push_back(deviates);
+        again.push_back(deviates);
+        curved = curved || deviates;
+
+      }
+
+      tRefined.push_back(t.back());
+      yRefined.push_back(y.back());
+
+      t.swap(tRefined);
+      y.swap(yRefined);
+      refine.swap(again);
+
+      if (!curved) break;
+
+    }
+
+    std::vector<Double_t> x;
+    std::vector<Double_t> values;
+    for (UInt_t point = 0; point < t.size(); point++){
+      if (!std::isfinite(y[point])) continue;
+      x.push_back(logX ? TMath::Power(10, t[point]) : t[point]);
+      values.push_back(y[point]);
+    }
+
+    // an existing graph is refilled, it may be drawn in a pad kept by Plot::Refresh
+    if (!sampled.graph) sampled.graph.reset(new TGraph(x.size()));
+    else sampled.graph->Set(x.size());
+    for (UInt_t point = 0; point < x.size(); point++) sampled.graph->SetPoint(point, x[point], values[point]);
+    sampled.graph->SetName(Form("%s_sampled", function->GetName()));
+    sampled.graph->SetTitle(function->GetTitle());
+    sampled.fingerprint = fingerprint;
+
+  }
+
+  function->TAttLine::Copy(*sampled.graph);
+  function->TAttFill::Copy(*sampled.graph);
+  function->TAttMarker::Copy(*sampled.graph);
+
+  return sampled.graph.get();
+
+}
@@ -0,0 +1,581 @@
+// ~~ SPEC ~~
+
+// ----------------------------------------------------------------------------
+//
+// This file contains the render plan, a declarative description of a plot.
+// A plain text spec of key = value pairs (separated by newlines or by ';'
+// followed by the next key, so titles may contain ';'; lines starting with
+// '#' are comments) is parsed and validated once by
+// RenderPlan::Compile into an immutable plan, which can then be drawn for
+// any number of input arrays without parsing anything again. Example:
+//
+//   class   = singleratio
+//   xtitle  = p_{T} (GeV/#it{c})
+//   ytitle  = counts
+//   rtitle  = data / MC
+//   ranges  = 0, 20, 1, 1e6, 0.5, 1.5
+//   log     = 0, 1
+//   colors  = 1, 2, 4
+//   markers = 20, 21, 22
+//   legend  = data | MC
+//   option[1] = SAME HIST
+//
+// Recognised keys:
+//  - class:        square (default), ratio, singleratio or heatmap
+//  - xtitle, ytitle, ztitle, rtitle: axis titles
+//  - ranges:       xLow, xUp, yLow, yUp[, zLow/rLow, zUp/rUp]
+//  - log:          0/1 for x, y[, z]
+//  - size:         width, height of the canvas
+//  - margins:      left, right, top, bottom or auto
+//  - titleoffsets: x, y[, z/r]
+//  - offset:       offset of the style arrays[, offset of the ratios]
+//  - colors, markers, sizes, lstyles, lwidths: style arrays
+//  - palette:      number of a ROOT palette
+//  - mode:         presentation or thesis
+//  - options:      draw option of all objects, or one per object separated
+//                  by | (main array, legend, ratio array)
+//  - option[N]:    draw option of the object at position N
+//  - legend:       legend entries separated by |, legendopt: their options
+//                  (one for all or separated by |), legendtitle, and
+//                  legendpos: x1, x2, y1, y2 (placed automatically if not given)
+//
+// ----------------------------------------------------------------------------
+
+#define SPEC_H
+
+// ----------------------------------------------------------------------------
+//                               RENDER PLAN CLASS
+// ----------------------------------------------------------------------------
+
+//! Class for an immutable, validated description of a plot that can be drawn for many input arrays
+
+class RenderPlan
+{
+
+public:
+
+  static std::shared_ptr<const RenderPlan> Compile(std::string spec, std::string& error);
+  static std::shared_ptr<const RenderPlan> Compile(std::string spec);
+
+  Bool_t Check(TObjArray* main, TObjArray* ratios, std::string& error) const;
+  Bool_t Draw(TObjArray* main, TString outname, TObjArray* ratios = nullptr) const;
+  Bool_t Draw(Booklet& booklet, TObjArray* main, TString title = "", TObjArray* ratios = nullptr) const;
+  Bool_t Validate(TObjArray* main, TObjArray* ratios, std::vector<std::string>& problems) const;
+
+  static std::vector<std::string> Split(const std::string& list, char delimiter);
+  static std::vector<std::string> SplitStatements(const std::string& spec);
+  static Bool_t ReadNumbers(const std::string& list, std::vector<Double_t>& numbers);
+
+private:
+
+  //! Plot classes a plan can be drawn with
+  enum Type {
+    kSquare,       //!< SquarePlot
+    kRatio,        //!< RatioPlot
+    kSingleRatio,  //!< SingleRatioPlot
+    kHeatMap       //!< HeatMapPlot
+  };
+
+  RenderPlan() {}
+
+  Bool_t Set(const std::string& key, const std::string& value, std::string& error);
+  Bool_t Validate(std::string& error) const;
+  Bool_t Execute(TObjArray* main, TObjArray* ratios, TString outname, Booklet* booklet, TString title,
+                 std::vector<std::string>* problems = nullptr) const;
+  template <class P> Bool_t Finish(P& plot, TString outname, Booklet* booklet, TString title,
+                                   std::vector<std::string>* problems) const;
+
+  Type type {kSquare};                              //!< Plot class to be used
+
+  TString titleX;                                   //!< Title of X-axis
+  TString titleY;                                   //!< Title of Y-axis
+  TString titleZ {"count"};                         //!< Title of Z-axis (heatmap)
+  TString titleR;                                   //!< Title of Y-axis of the ratios (single ratio)
+
+  std::vector<Double_t> ranges;                     //!< Axis ranges
+  std::vector<Double_t> logs;                       //!< Logarithmic axes
+  std::vector<Double_t> dimensions;                 //!< Canvas width and height
+  std::vector<Double_t> margins;                    //!< Left, right, top and bottom margin
+  std::vector<Double_t> titleOffsets;               //!< Offsets of the axis titles
+  std::vector<Double_t> styleOffsets;               //!< Offsets for the style arrays
+
+  std::vector<Color_t> colors;                      //!< Object colors
+  std::vector<Style_t> markers;                     //!< Object marker styles
+  std::vector<Size_t>  sizes;                       //!< Object marker sizes
+  std::vector<Style_t> lstyles;                     //!< Object line styles
+  std::vector<Size_t>  lwidths;                     //!< Object line widths
+  Int_t palette {-1};                               //!< ROOT palette, -1 if not set
+  Int_t mode {-1};                                  //!< Plot::Mode, -1 if not set
+  Bool_t marginsAuto {kFALSE};                      //!< Should margins be fitted automatically?
+
+  std::vector<std::string> options;                 //!< Draw options of all objects
+  std::vector<std::pair<Int_t, std::string>> positionOptions; //!< Draw options of single objects
+
+  std::vector<std::string> legendEntries;           //!< Legend entries
+  std::vector<std::string> legendOptions;           //!< Legend entry options
+  std::string legendTitle;                          //!< Legend title
+  std::vector<Double_t> legendPosition;             //!< Legend position, automatic if empty
+
+};
+
+// ---- Member Functions ------------------------------------------------------
+
+std::shared_ptr<const RenderPlan> RenderPlan::Compile(std::string spec, std::string& error){
+
+  /** Parses and validates \p spec, returns the plan or a null pointer with
+      the reason in \p error. Nothing is drawn for a rejected spec. **/
+
+  std::shared_ptr<RenderPlan> plan(new RenderPlan());
+  std::set<std::string> keys;
+
+  for (const std::string& line : SplitStatements(spec)){
+
+    if (line[0] == '#') continue;   // '#' inside values is ROOT latex
+
+    size_t equal = line.find('=');
+    if (equal == std::string::npos){
+      error = "missing '=' in \"" + line + "\"";
+      return nullptr;
+    }
+
+    std::string key   = line.substr(0, equal);
+    std::string value = line.substr(equal + 1);
+    key.erase(key.find_last_not_of(" \t") + 1);
+    value.erase(0, value.find_first_not_of(" \t"));
+
+    if (!keys.insert(key).second){
+      error = "key " + key + " given twice";
+      return nullptr;
+    }
+
+    if (!plan->Set(key, value, error)) return nullptr;
+
+  }
+
+  if (!plan->Validate(error)) return nullptr;
+
+  return plan;
+
+}
+
+std::shared_ptr<const RenderPlan> RenderPlan::Compile(std::string spec){
+
+  /** Parses and validates \p spec, errors are printed **/
+
+  std::string error;
+  std::shared_ptr<const RenderPlan> plan = Compile(spec, error);
+  if (!plan) std::cout << "\033[1;31mERROR in Spec:\033[0m " << error << std::endl;
+
+  return plan;
+
+}
+
+Bool_t RenderPlan::Set(const std::string& key, const std::string& value, std::string& error){
+
+  /** Stores a single key of the spec in its parsed form **/
+
+  std::vector<Double_t> numbers;
+  Bool_t numeric = ReadNumbers(value, numbers);
+
+  if (key == "class"){
+    if      (value == "square")      type = kSquare;
+    else if (value == "ratio")       type = kRatio;
+    else if (value == "singleratio") type = kSingleRatio;
+    else if (value == "heatmap")     type = kHeatMap;
+    else { error = "unknown class " + value; return kFALSE; }
+  }
+  else if (key == "xtitle") titleX = value;
+  else if (key == "ytitle") titleY = value;
+  else if (key == "ztitle") titleZ = value;
+  else if (key == "rtitle") titleR = value;
+  else if (key == "legendtitle") legendTitle = value;
+  else if (key == "options") options = Split(value, '|');
+  else if (key == "legend") legendEntries = Split(value, '|');
+  else if (key == "legendopt") legendOptions = Split(value, '|');
+  else if (key == "mode"){
+    if      (value == "presentation") mode = Plot::Presentation;
+    else if (value == "thesis")       mode = Plot::Thesis;
+    else { error = "unknown mode " + value; return kFALSE; }
+  }
+  else if (key == "margins" && value == "auto") marginsAuto = kTRUE;
+  else if (key.compare(0, 7, "option[") == 0 && key.back() == ']'){
+    char* end;
+    Long_t pos = std::strtol(key.data() + 7, &end, 10);
+    if (end != key.data() + key.size() - 1 || pos < 0){
+      error = "invalid position in " + key;
+      return kFALSE;
+    }
+    positionOptions.emplace_back(pos, value);
+  }
+  else {
+
+    std::vector<Double_t>* target = nullptr;
+    if      (key == "ranges")       target = &ranges;
+    else if (key == "log")          target = &logs;
+    else if (key == "size")         target = &dimensions;
+    else if (key == "margins")      target = &margins;
+    else if (key == "titleoffsets") target = &titleOffsets;
+    else if (key == "offset")       target = &styleOffsets;
+    else if (key == "legendpos")    target = &legendPosition;
+    else if (key != "colors" && key != "markers" && key != "sizes" && key != "lstyles"
+          && key != "lwidths" && key != "palette"){
+      error = "unknown key " + key;
+      return kFALSE;
+    }
+
+    if (!numeric || numbers.empty()){
+      error = "invalid list of numbers for " + key + ": \"" + value + "\"";
+      return kFALSE;
+    }
+
+    if (target) *target = numbers;
+    else if (key == "colors")  colors.assign(numbers.begin(), numbers.end());
+    else if (key == "markers") markers.assign(numbers.begin(), numbers.end());
+    else if (key == "sizes")   sizes.assign(numbers.begin(), numbers.end());
+    else if (key == "lstyles") lstyles.assign(numbers.begin(), numbers.end());
+    else if (key == "lwidths") lwidths.assign(numbers.begin(), numbers.end());
+    else if (key == "palette") palette = numbers[0];
+
+  }
+
+  return kTRUE;
+
+}
+
+Bool_t RenderPlan::Validate(std::string& error) const {
+
+  /** Checks the consistency of all keys with each other and with the plot class **/
+
+  UInt_t nRanges = (type == kSquare || type == kRatio) ? 4 : 6;
+  if (!ranges.empty() && ranges.size() != nRanges && !(type == kSingleRatio && ranges.size() == 4)){
+    error = "ranges need " + std::to_string(nRanges) + " values for this class";
+    return kFALSE;
+  }
+  for (UInt_t range = 0; range + 1 < ranges.size(); range += 2){
+    if (ranges[range] >= ranges[range + 1]){
+      error = "lower range above upper range";
+      return kFALSE;
+    }
+  }
+
+  if (logs.size() > (type == kHeatMap ? 3u : 2u)){
+    error = "too many values for log";
+    return kFALSE;
+  }
+  for (UInt_t axis = 0; axis < logs.size(); axis++){
+    if (logs[axis] != 0 && logs[axis] != 1){
+      error = "log only accepts 0 or 1";
+      return kFALSE;
+    }
+    if (logs[axis] && 2*axis + 1 < ranges.size() && ranges[2*axis] <= 0){
+      error = "logarithmic axis with range below or at zero";
+      return kFALSE;
+    }
+  }
+
+  if (!dimensions.empty() && (dimensions.size() != 2 || dimensions[0] <= 0 || dimensions[1] <= 0)){
+    error = "size needs a positive width and height";
+    return kFALSE;
+  }
+
+  if (!margins.empty() && margins.size() != 4){
+    error = "margins need 4 values (left, right, top, bottom) or auto";
+    return kFALSE;
+  }
+
+  if (titleOffsets.size() == 1 || titleOffsets.size() > ((type == kSingleRatio || type == kHeatMap) ? 3u : 2u)){
+    error = "wrong number of titleoffsets for this class";
+    return kFALSE;
+  }
+
+  if (styleOffsets.size() > (type == kSingleRatio ? 2u : 1u)){
+    error = "too many values for offset";
+    return kFALSE;
+  }
+
+  if (!legendOptions.empty() && legendOptions.size() != 1 && legendOptions.size() != legendEntries.size()){
+    error = "legendopt needs one option or one per legend entry";
+    return kFALSE;
+  }
+
+  if (!legendPosition.empty() && legendPosition.size() != 4){
+    error = "legendpos needs 4 values (x1, x2, y1, y2)";
+    return kFALSE;
+  }
+
+  if (legendEntries.empty() && (!legendOptions.empty() || !legendPosition.empty() || !legendTitle.empty())){
+    error = "legend settings given without legend entries";
+    return kFALSE;
+  }
+
+  return kTRUE;
+
+}
+
+Bool_t RenderPlan::Check(TObjArray* main, TObjArray* ratios, std::string& error) const {
+
+  /** Checks wether the plan can be drawn with the arrays \p main and \p ratios,
+      without drawing anything **/
+
+  if (!main || !main->GetEntries()){
+    error = "main array is empty";
+    return kFALSE;
+  }
+
+  if (type == kSingleRatio && (!ratios || !ratios->GetEntries())){
+    error = "ratio array is empty";
+    return kFALSE;
+  }
+
+  if (!main->At(0) || !main->At(0)->InheritsFrom(type == kHeatMap ? "TH2" : "TObject")){
+    error = (type == kHeatMap) ? "first object must be a TH2" : "first object is broken";
+    return kFALSE;
+  }
+
+  Int_t nObjects = main->GetEntries() + !legendEntries.empty();
+  if (type == kSingleRatio) nObjects += ratios->GetEntries();
+
+  if (options.size() > 1 && (Int_t)options.size() != nObjects){
+    error = "options given for " + std::to_string(options.size()) + " objects, but "
+            + std::to_string(nObjects) + " objects will be drawn";
+    return kFALSE;
+  }
+
+  for (auto& option : positionOptions){
+    if (option.first >= nObjects){
+      error = "option[" + std::to_string(option.first) + "] is out of range";
+      return kFALSE;
+    }
+  }
+
+  if ((Int_t)legendEntries.size() > main->GetEntries()){
+    error = "more legend entries than objects";
+    return kFALSE;
+  }
+
+  return kTRUE;
+
+}
+
+Bool_t RenderPlan::Draw(TObjArray* main, TString outname, TObjArray* ratios) const {
+
+  /** Draws the plot for the arrays \p main (and \p ratios) and saves it as \p outname **/
+
+  return Execute(main, ratios, outname, nullptr, "");
+
+}
+
+Bool_t RenderPlan::Draw(Booklet& booklet, TObjArray* main, TString title, TObjArray* ratios) const {
+
+  /** Draws the plot for the arrays \p main (and \p ratios) as next page of \p booklet **/
+
+  return Execute(main, ratios, "", &booklet, title);
+
+}
+
+Bool_t RenderPlan::Validate(TObjArray* main, TObjArray* ratios, std::vector<std::string>& problems) const {
+
+  /** Sets up the plot for the arrays \p main (and \p ratios) like Draw, but
+      only validates it instead of drawing it. All problems are appended to
+      \p problems, returns kTRUE if there are none. **/
+
+  size_t nProblems = problems.size();
+  Execute(main, ratios, "", nullptr, "", &problems);
+
+  return problems.size() == nProblems;
+
+}
+
+Bool_t RenderPlan::Execute(TObjArray* main, TObjArray* ratios, TString outname, Booklet* booklet, TString title,
+                           std::vector<std::string>* problems) const {
+
+  /** Sets up the plot class of the plan and draws it, or only validates it
+      if \p problems is given. The arrays are not changed, the legend is added
+      to a copy of \p main. **/
+
+  std::string error;
+  if (!Check(main, ratios, error)){
+    if (problems){
+      problems->push_back(error);
+      return kFALSE;
+    }
+    std::cout << "\033[1;31mERROR in Spec:\033[0m " << error << ". Plot will not be drawn." << std::endl;
+    return kFALSE;
+  }
+
+  TObjArray array(main->GetEntries() + 1);
+  for (Int_t index = 0; index < main->GetEntries(); index++) array.Add(main->At(index));
+
+  Legend* legend = nullptr;
+  if (!legendEntries.empty()){
+
+    std::vector<std::string> opts = legendOptions;
+    if (opts.size() == 1) opts.assign(legendEntries.size(), legendOptions[0]);
+
+    LegendBuilder builder(legendTitle);
+    builder.Add(&array, legendEntries, opts);
+    builder.SetLayoutAuto(legendPosition.empty());
+    builder.SetPositionAuto(legendPosition.empty());
+
+    legend = builder.Build();
+    if (!legendPosition.empty()) legend->SetPosition(legendPosition[0], legendPosition[1], legendPosition[2], legendPosition[3]);
+    array.Add(legend);
+
+  }
+
+  // the plan starts from the default style, the style of the caller is restored afterwards
+  Plot::SharedStyle style = Plot::SaveStyle();
+  Plot::ResetStyle();
+
+  Bool_t drawn = kFALSE;
+  Double_t logX = logs.size() > 0 ? logs[0] : 0;
+  Double_t logY = logs.size() > 1 ? logs[1] : 0;
+
+  if (type == kSquare){
+
+    SquarePlot plot(&array, titleX, titleY);
+    if (!ranges.empty()) plot.SetRanges(ranges[0], ranges[1], ranges[2], ranges[3]);
+    if (!titleOffsets.empty()) plot.SetCanvasOffsets(titleOffsets[0], titleOffsets[1]);
+    if (!styleOffsets.empty()) plot.SetOffset(styleOffsets[0]);
+    plot.SetLog(logX, logY);
+    drawn = Finish(plot, outname, booklet, title, problems);
+
+  }
+  else if (type == kRatio){
+
+    RatioPlot plot(&array, titleX, titleY);
+    if (!ranges.empty()) plot.SetRanges(ranges[0], ranges[1], ranges[2], ranges[3]);
+    if (!titleOffsets.empty()) plot.SetCanvasOffsets(titleOffsets[0], titleOffsets[1]);
+    if (!styleOffsets.empty()) plot.SetOffset(styleOffsets[0]);
+    plot.SetLog(logX, logY);
+    drawn = Finish(plot, outname, booklet, title, problems);
+
+  }
+  else if (type == kSingleRatio){
+
+    SingleRatioPlot plot(&array, ratios, titleX, titleY, titleR);
+    if (ranges.size() == 6) plot.SetRanges(ranges[0], ranges[1], ranges[2], ranges[3], ranges[4], ranges[5]);
+    else if (!ranges.empty()) plot.Plot::SetRanges(ranges[0], ranges[1], ranges[2], ranges[3]);
+    if (!titleOffsets.empty()) plot.SetCanvasOffsets(titleOffsets[0], titleOffsets[1], titleOffsets.size() > 2 ? titleOffsets[2] : 0);
+    if (!styleOffsets.empty()) plot.SetOffset(styleOffsets[0], styleOffsets.size() > 1 ? styleOffsets[1] : 0);
+    plot.SetLog(logX, logY);
+    drawn = Finish(plot, outname, booklet, title, problems);
+
+  }
+  else if (type == kHeatMap){
+
+    HeatMapPlot plot(&array, titleX, titleY, titleZ);
+    if (!ranges.empty()) plot.SetRanges(ranges[0], ranges[1], ranges[2], ranges[3], ranges[4], ranges[5]);
+    if (!titleOffsets.empty()) plot.SetCanvasOffsets(titleOffsets[0], titleOffsets[1], titleOffsets.size() > 2 ? titleOffsets[2] : 1.4);
+    plot.SetLog(logX, logY, logs.size() > 2 ? logs[2] : 0);
+    drawn = Finish(plot, outname, booklet, title, problems);
+
+  }
+
+  delete legend;
+  Plot::RestoreStyle(style);
+
+  return drawn;
+
+}
+
+template <class P>
+Bool_t RenderPlan::Finish(P& plot, TString outname, Booklet* booklet, TString title,
+                          std::vector<std::string>* problems) const {
+
+  /** Applies the settings shared by all plot classes and draws the plot
+      (or validates it, if \p problems is given) **/
+
+  if (mode >= 0) plot.SetMode((Plot::Mode)mode);
+  if (palette >= 0) plot.SetPalette(palette);
+  if (!colors.empty() || !markers.empty()) plot.SetStyle(colors, markers, sizes, lstyles, lwidths);
+  if (!dimensions.empty()) plot.SetCanvasDimensions(dimensions[0], dimensions[1]);
+  if (!margins.empty()) plot.SetCanvasMargins(margins[0], margins[1], margins[2], margins[3]);
+  if (marginsAuto) plot.SetMarginsAuto();
+
+  if (options.size() == 1) plot.Plot::SetOptions(TString(options[0]));
+  else if (!options.empty()) plot.Plot::SetOptions(options);
+  for (auto& option : positionOptions) plot.SetOption(option.second, option.first);
+
+  if (problems) return plot.Validate(*problems);
+  if (plot.IsBroken()) return kFALSE;
+
+  if (booklet) plot.Draw(*booklet, title);
+  else plot.Draw(outname);
+
+  return kTRUE;
+
+}
+
+std::vector<std::string> RenderPlan::Split(const std::string& list, char delimiter){
+
+  /** Splits \p list at every \p delimiter, leading and trailing blanks are removed **/
+
+  std::vector<std::string> items;
+  std::istringstream stream(list);
+  std::string item;
+
+  while (std::getline(stream, item, delimiter)){
+    item.erase(item.find_last_not_of(" \t") + 1);
+    item.erase(0, item.find_first_not_of(" \t"));
+    if (!item.empty()) items.push_back(item);
+  }
+
+  return items;
+
+}
+
+std::vector<std::string> RenderPlan::SplitStatements(const std::string& spec){
+
+  /** Splits \p spec into its key = value statements. Statements end at a
+      newline, or at a ';' that is followed by the next key (or nothing), so
+      a ';' inside a title or label stays part of it. Blanks around the
+      statements are removed, empty statements are skipped. **/
+
+  std::vector<std::string> statements;
+  std::string statement;
+
+  auto finish = [&](){
+    statement.erase(statement.find_last_not_of(" \t\r") + 1);
+    statement.erase(0, statement.find_first_not_of(" \t"));
+    if (!statement.empty()) statements.push_back(statement);
+    statement.clear();
+  };
+
+  // does a key (letters, digits, '_' and [N]) followed by '=' start at pos?
+  auto startsStatement = [&spec](size_t pos){
+    while (pos < spec.size() && (spec[pos] == ' ' || spec[pos] == '\t')) pos++;
+    if (pos == spec.size() || spec[pos] == '\n' || spec[pos] == '\r' || spec[pos] == ';') return kTRUE;
+    size_t key = pos;
+    while (pos < spec.size() && (std::isalnum((unsigned char)spec[pos]) || spec[pos] == '_' || spec[pos] == '[' || spec[pos] == ']')) pos++;
+    if (pos == key) return kFALSE;
+    while (pos < spec.size() && (spec[pos] == ' ' || spec[pos] == '\t')) pos++;
+    return (Bool_t)(pos < spec.size() && spec[pos] == '=');
+  };
+
+  for (size_t pos = 0; pos < spec.size(); pos++){
+    if (spec[pos] == '\n' || (spec[pos] == ';' && startsStatement(pos + 1))) finish();
+    else statement += spec[pos];
+  }
+  finish();
+
+  return statements;
+
+}
+
+Bool_t RenderPlan::ReadNumbers(const std::string& list, std::vector<Double_t>& numbers){
+
+  /** Reads a comma separated list of numbers, returns kFALSE if any of them is malformed **/
+
+  numbers.clear();
+
+  for (const std::string& item : Split(list, ',')){
+    char* end;
+    Double_t number = std::strtod(item.data(), &end);
+    if (end != item.data() + item.size() || !std::isfinite(number)) return kFALSE;
+    numbers.push_back(number);
+  }
+
+  return kTRUE;
+
+}
@@ -41,16 +41,17 @@ Int_t GetXlastFilledBin(AO* hst){
 
 }
 
-void CleanUpHistogram(TH1* hist, Double_t factor){
+Int_t CleanUpHistogram(TH1* hist, Double_t factor){
 
   /** Sets bin contents of bins with too large uncertainties to zero. **/
   /** The function finds the first bin (from the left) where the errorbar exceeds
       more than 100*\p factor percent of the range that is spanned by the histogram
-      values and sets the content of this and all following bins to zero**/
+      values and sets the content of this and all following bins to zero.
+      Returns the cutoff bin (-1 if the histogram does not exist) **/
 
   if (!hist){
     std::cout << "\033[1;31mERROR:\033[0m histogram to be cleaned up does not exist!" << std::endl;
-    return;
+    return -1;
   }
 
   Int_t cutoff = hist->GetNbinsX();
@@ -70,4 +71,679 @@ void CleanUpHistogram(TH1* hist, Double_t factor){
 
   }
 
+  return cutoff;
+
+}
+
+void ParallelFor(Int_t nTasks, const std::function<void(Int_t)>& task, Int_t nThreads = 0){
+
+  /** Calls \p task for every index in [0, \p nTasks) using \p nThreads threads,
+      all hardware threads are used if \p nThreads is 0. Indices are handed out
+      one at a time, so tasks of very different cost are still balanced.
+      Each task must only modify objects belonging to its own index. **/
+
+  if (nTasks <= 0) return;
+  if (nThreads <= 0) nThreads = std::max(1u, std::thread::hardware_concurrency());
+  nThreads = std::min(nThreads, nTasks);
+
+  if (nThreads == 1){
+    for (Int_t index = 0; index < nTasks; index++) task(index);
+    return;
+  }
+
+  ROOT::EnableThreadSafety();
+
+  std::atomic<Int_t> next {0};
+  auto worker = [&](){
+    for (Int_t index = next++; index < nTasks; index = next++) task(index);
+  };
+
+  std::vector<std::thread> threads;
+  for (Int_t thread = 1; thread < nThreads; thread++) threads.emplace_back(worker);
+  worker();
+  for (std::thread& thread : threads) thread.join();
+
+}
+
+ULong64_t HashObject(TObject* obj, Bool_t contents = kTRUE, ULong64_t hash = 14695981039346656037ULL){
+
+  /** Hashes (FNV-1a) the identity of \p obj and the number of entries of
+      histograms, points of graphs and parameters of functions; with
+      \p contents also all bins, errors and points. Hashes of several objects
+      are chained by passing the previous one as \p hash. **/
+
+  auto add = [&hash](ULong64_t value){hash = (hash ^ value)*1099511628211ULL;};
+  auto addArray = [&add](const Double_t* values, Int_t n){
+    if (!values) return;
+    for (Int_t index = 0; index < n; index++){
+      ULong64_t bits;
+      std::memcpy(&bits, values + index, sizeof(bits));
+      add(bits);
+    }
+  };
+
+  add((ULong64_t)obj);
+  if (!obj) return hash;
+
+  if (obj->InheritsFrom("TH1")){
+    TH1* hist = (TH1*)obj;
+    Double_t entries = hist->GetEntries();
+    addArray(&entries, 1);
+    if (!contents) return hash;
+    for (Int_t bin = 0; bin < hist->GetNcells(); bin++){
+      Double_t content = hist->GetBinContent(bin);
+      addArray(&content, 1);
+    }
+    if (hist->GetSumw2N()) addArray(hist->GetSumw2()->GetArray(), hist->GetSumw2N());
+  }
+  else if (obj->InheritsFrom("TGraph")){
+    TGraph* graph = (TGraph*)obj;
+    Int_t n = graph->GetN();
+    add(n);
+    if (!contents) return hash;
+    for (const Double_t* column : {graph->GetX(), graph->GetY(), graph->GetEX(), graph->GetEY(), graph->GetEXlow(),
+                                   graph->GetEXhigh(), graph->GetEYlow(), graph->GetEYhigh()}) addArray(column, n);
+  }
+  else if (obj->InheritsFrom("TF1")){
+    TF1* function = (TF1*)obj;
+    addArray(function->GetParameters(), function->GetNpar());
+  }
+
+  return hash;
+
+}
+
+template <class T>
+Int_t CleanUpHistogramRaw(TH1* hist, T* content, Double_t factor){
+
+  /** Same as CleanUpHistogram, but working directly on the bin storage \p content
+      of a one dimensional \p hist. Range and errors are collected in one pass, only
+      bins with an error larger than all errors to their left can be the cutoff,
+      so just these few candidates have to be compared to the range afterwards. **/
+
+  Int_t nBins  = hist->GetNbinsX();
+  Int_t xFirst = hist->GetXaxis()->GetFirst();
+  Int_t xLast  = hist->GetXaxis()->GetLast();
+
+  Double_t* sumw2 = hist->GetSumw2()->GetArray();
+  if (!hist->GetSumw2N()) sumw2 = nullptr;
+
+  Double_t maximum = -FLT_MAX;
+  Double_t minimum =  FLT_MAX;
+  Float_t  largest = -1;
+  std::vector<std::pair<Int_t, Float_t>> candidates;
+
+  for (Int_t bin = 0; bin <= nBins; bin++){
+
+    Double_t value = content[bin];
+
+    if (bin >= xFirst && bin <= xLast){
+      if (value > maximum && value <  FLT_MAX) maximum = value;
+      if (value < minimum && value > -FLT_MAX) minimum = value;
+    }
+
+    Float_t error = 2*(sumw2 ? TMath::Sqrt(sumw2[bin]) : TMath::Sqrt(TMath::Abs(value)));
+    if (error > largest){
+      largest = error;
+      candidates.emplace_back(bin, error);
+    }
+
+  }
+
+  if (hist->GetMaximumStored() != -1111) maximum = hist->GetMaximumStored();
+  if (hist->GetMinimumStored() != -1111) minimum = hist->GetMinimumStored();
+
+  Int_t cutoff = nBins;
+  Float_t range = TMath::Abs(maximum - minimum);
+
+  for (const std::pair<Int_t, Float_t>& candidate : candidates){
+    if (candidate.second/range >= factor){
+      cutoff = candidate.first;
+      break;
+    }
+  }
+
+  if (cutoff >= nBins) return cutoff;
+
+  if (!sumw2){
+    hist->Sumw2();
+    sumw2 = hist->GetSumw2()->GetArray();
+  }
+
+  std::fill(content + cutoff, content + nBins, 0);
+  std::fill(sumw2 + cutoff, sumw2 + nBins, 0.);
+
+  // SetBinContent counts every call as an entry and invalidates the stored statistics
+  Double_t stats[4] = {0., 0., 0., 0.};
+  hist->SetEntries(hist->GetEntries() + nBins - cutoff);
+  hist->PutStats(stats);
+
+  return cutoff;
+
+}
+
+std::vector<Int_t> CleanUpHistograms(TObjArray* array, Double_t factor, Int_t nThreads = 0){
+
+  /** Batch version of CleanUpHistogram for all histograms in \p array, spread over
+      \p nThreads threads (all hardware threads if 0). The cutoff semantics are the
+      same as for a single histogram.
+      Returns the cutoff bin of every entry in the array, -1 for entries that are
+      no histograms (e.g. legends) **/
+
+  if (!array){
+    std::cout << "\033[1;31mERROR:\033[0m array to be cleaned up does not exist!" << std::endl;
+    return {};
+  }
+
+  Int_t nEntries = array->GetEntriesFast();
+  std::vector<Int_t> cutoffs(nEntries, -1);
+  std::vector<TH1*>  hists(nEntries, nullptr);
+
+  for (Int_t entry = 0; entry < nEntries; entry++){
+    TObject* obj = array->At(entry);
+    if (obj && obj->InheritsFrom("TH1")) hists[entry] = (TH1*)obj;
+  }
+
+  ParallelFor(nEntries, [&](Int_t entry){
+
+    TH1* hist = hists[entry];
+    if (!hist) return;
+
+    hist->BufferEmpty();
+
+    // the storage of profiles holds sums of values, not bin contents
+    if (hist->GetDimension() != 1 || hist->GetBinErrorOption() != TH1::kNormal || hist->InheritsFrom("TProfile")){
+      cutoffs[entry] = CleanUpHistogram(hist, factor);
+    }
+    else if (TArrayD* raw = dynamic_cast<TArrayD*>(hist)) cutoffs[entry] = CleanUpHistogramRaw(hist, raw->GetArray(), factor);
+    else if (TArrayF* raw = dynamic_cast<TArrayF*>(hist)) cutoffs[entry] = CleanUpHistogramRaw(hist, raw->GetArray(), factor);
+    else if (TArrayI* raw = dynamic_cast<TArrayI*>(hist)) cutoffs[entry] = CleanUpHistogramRaw(hist, raw->GetArray(), factor);
+    else if (TArrayS* raw = dynamic_cast<TArrayS*>(hist)) cutoffs[entry] = CleanUpHistogramRaw(hist, raw->GetArray(), factor);
+    else if (TArrayC* raw = dynamic_cast<TArrayC*>(hist)) cutoffs[entry] = CleanUpHistogramRaw(hist, raw->GetArray(), factor);
+    else cutoffs[entry] = CleanUpHistogram(hist, factor);
+
+  }, nThreads);
+
+  return cutoffs;
+
+}
+
+//! Result of fitting one histogram with FitHistograms
+struct FitSummary {
+  TF1*     function {nullptr};   //!< Fitted copy of the model, nullptr for entries that are no histograms
+  Int_t    status {-1};          //!< Status of the fit, 0 if it converged
+  Double_t chi2 {0};             //!< Chi2 of the fit
+  Int_t    ndf {0};              //!< Number of degrees of freedom
+  Double_t prob {0};             //!< Chi2 probability
+};
+
+std::vector<FitSummary> FitHistograms(TObjArray* array, TF1* model, TString option = "", Int_t nThreads = 0){
+
+  /** Fits \p model to all histograms in \p array, spread over \p nThreads
+      threads (all hardware threads if 0). Of the fit options of TH1::Fit,
+      \p option supports "L" (likelihood), "W" (unit errors), "I" (integral
+      over the bins) and "R" (range of the model), others are ignored.
+      Every histogram is fitted with its own copy of the model, all copies
+      are made beforehand since creating functions is not thread safe; the
+      histograms themselves are not changed. Each fit runs its own
+      ROOT::Fit::Fitter instead of TH1::Fit, which keeps the last fit in the
+      global TVirtualFitter and would race between threads. Fits use Minuit2
+      if the default minimizer is the (not thread safe) TMinuit.
+      Returns the fitted function (owned by the caller, ready to be added to
+      the array of the plot), status and chi2 of every entry of the array. **/
+
+  if (!array || !model){
+    std::cout << "\033[1;31mERROR:\033[0m array or model to be fitted does not exist!" << std::endl;
+    return {};
+  }
+
+  Int_t nEntries = array->GetEntriesFast();
+  std::vector<FitSummary> fits(nEntries);
+  std::vector<TH1*> hists(nEntries, nullptr);
+
+  for (Int_t entry = 0; entry < nEntries; entry++){
+    TObject* obj = array->At(entry);
+    if (!obj || !obj->InheritsFrom("TH1")) continue;
+    hists[entry] = (TH1*)obj;
+    hists[entry]->BufferEmpty();
+    fits[entry].function = (TF1*)model->Clone(Form("%s_%s", model->GetName(), obj->GetName()));
+  }
+
+  std::string minimizer = ROOT::Math::MinimizerOptions::DefaultMinimizerType();
+  if (minimizer == "Minuit" || minimizer == "TMinuit") minimizer = "Minuit2";
+
+  option.ToUpper();
+  Bool_t likelihood = option.Contains("L");
+
+  ROOT::Fit::DataOptions dataOptions;
+  dataOptions.fErrors1  = option.Contains("W");
+  dataOptions.fIntegral = option.Contains("I");
+
+  ParallelFor(nEntries, [&](Int_t entry){
+
+    TH1* hist = hists[entry];
+    if (!hist) return;
+
+    FitSummary& fit = fits[entry];
+    TF1* function = fit.function;
+
+    ROOT::Fit::DataRange range;
+    if (option.Contains("R")) range.SetRange(function->GetXmin(), function->GetXmax());
+
+    ROOT::Fit::BinData data(dataOptions, range);
+    ROOT::Fit::FillData(data, hist, function);
+
+    ROOT::Math::WrappedMultiTF1 wrapped(*function, function->GetNdim());
+    ROOT::Fit::Fitter fitter;
+    fitter.Config().SetMinimizer(minimizer.data());
+    fitter.SetFunction(wrapped, kFALSE);
+
+    // limits and fixed parameters of the model, as TH1::Fit takes them over
+    for (Int_t par = 0; par < function->GetNpar(); par++){
+      Double_t low, up;
+      function->GetParLimits(par, low, up);
+      if (low < up) fitter.Config().ParSettings(par).SetLimits(low, up);
+      else if (low == up && low != 0) fitter.Config().ParSettings(par).Fix();
+    }
+
+    if (likelihood) fitter.LikelihoodFit(data);
+    else fitter.Fit(data);
+
+    const ROOT::Fit::FitResult& result = fitter.Result();
+    fit.status = result.Status();
+    if (result.GetParams()) function->SetParameters(result.GetParams());
+    if (!result.Errors().empty()) function->SetParErrors(result.Errors().data());
+    function->SetChisquare(result.Chi2());
+    function->SetNDF(result.Ndf());
+    function->SetNumberFitPoints(data.Size());
+
+    fit.chi2 = function->GetChisquare();
+    fit.ndf  = function->GetNDF();
+    fit.prob = function->GetProb();
+
+  }, nThreads);
+
+  Int_t nFits = 0, nFailed = 0;
+  for (Int_t entry = 0; entry < nEntries; entry++){
+    if (!hists[entry]) continue;
+    nFits++;
+    if (fits[entry].status == 0) continue;
+    nFailed++;
+    std::cout << "\033[1;31mERROR:\033[0m Fit of " << hists[entry]->GetName() << " failed with status " << fits[entry].status << std::endl;
+  }
+  std::cout << "Info: " << nFits - nFailed << " of " << nFits << " fits converged" << std::endl;
+
+  return fits;
+
+}
+
+//! Base of all histogram expressions (cf. Expr), E is the derived expression
+template <class E>
+struct HistExpression {
+  const E& Self() const {return static_cast<const E&>(*this);} //!< The derived expression
+};
+
+//! Histogram as operand of a histogram expression, created by Expr
+struct HistLeaf : HistExpression<HistLeaf> {
+  TH1* hist {nullptr};                                  //!< Histogram
+  const Double_t* contents {nullptr};                   //!< Bin storage, including under- and overflow
+  const Double_t* sumw2 {nullptr};                      //!< Squared errors, nullptr for Poisson errors
+  std::shared_ptr<std::vector<Double_t>> converted;     //!< Contents (and squared errors of profiles) of histograms that are not read directly
+
+  void Evaluate(Int_t cell, Double_t& value, Double_t& variance) const {
+    value    = contents[cell];
+    variance = sumw2 ? sumw2[cell] : std::abs(value);
+  }
+  void Collect(std::vector<TH1*>& hists) const {hists.push_back(hist);}
+};
+
+//! Constant operand of a histogram expression, without uncertainty
+struct HistScalar : HistExpression<HistScalar> {
+  Double_t constant;                                    //!< Value
+
+  HistScalar(Double_t c): constant(c) {}
+  void Evaluate(Int_t, Double_t& value, Double_t& variance) const {value = constant; variance = 0;}
+  void Collect(std::vector<TH1*>&) const {}
+};
+
+//! Operation on two histogram expressions, Op propagates the values and variances of one bin
+template <class A, class B, class Op>
+struct HistBinary : HistExpression<HistBinary<A, B, Op>> {
+  A a;                                                  //!< Left operand
+  B b;                                                  //!< Right operand
+
+  HistBinary(const A& left, const B& right): a(left), b(right) {}
+  void Evaluate(Int_t cell, Double_t& value, Double_t& variance) const {
+    Double_t aValue, aVariance, bValue, bVariance;
+    a.Evaluate(cell, aValue, aVariance);
+    b.Evaluate(cell, bValue, bVariance);
+    Op::Apply(aValue, aVariance, bValue, bVariance, value, variance);
+  }
+  void Collect(std::vector<TH1*>& hists) const {a.Collect(hists); b.Collect(hists);}
+};
+
+//! Sum of two operands
+struct HistAdd {
+  static void Apply(Double_t a, Double_t va, Double_t b, Double_t vb, Double_t& value, Double_t& variance){
+    value = a + b;
+    variance = va + vb;
+  }
+};
+
+//! Difference of two operands
+struct HistSub {
+  static void Apply(Double_t a, Double_t va, Double_t b, Double_t vb, Double_t& value, Double_t& variance){
+    value = a - b;
+    variance = va + vb;
+  }
+};
+
+//! Product of two operands
+struct HistMul {
+  static void Apply(Double_t a, Double_t va, Double_t b, Double_t vb, Double_t& value, Double_t& variance){
+    value = a*b;
+    variance = b*b*va + a*a*vb;
+  }
+};
+
+//! Quotient of two operands, zero where the denominator is zero (as TH1::Divide)
+struct HistDiv {
+  static void Apply(Double_t a, Double_t va, Double_t b, Double_t vb, Double_t& value, Double_t& variance){
+    Double_t ratio = b ? a/b : 0.;
+    value = ratio;
+    variance = b ? (va + ratio*ratio*vb)/(b*b) : 0.;
+  }
+};
+
+template <class A, class B> HistBinary<A, B, HistAdd> operator+(const HistExpression<A>& a, const HistExpression<B>& b) {return {a.Self(), b.Self()};}
+template <class A, class B> HistBinary<A, B, HistSub> operator-(const HistExpression<A>& a, const HistExpression<B>& b) {return {a.Self(), b.Self()};}
+template <class A, class B> HistBinary<A, B, HistMul> operator*(const HistExpression<A>& a, const HistExpression<B>& b) {return {a.Self(), b.Self()};}
+template <class A, class B> HistBinary<A, B, HistDiv> operator/(const HistExpression<A>& a, const HistExpression<B>& b) {return {a.Self(), b.Self()};}
+
+template <class A> HistBinary<A, HistScalar, HistAdd> operator+(const HistExpression<A>& a, Double_t c) {return {a.Self(), c};}
+template <class A> HistBinary<A, HistScalar, HistSub> operator-(const HistExpression<A>& a, Double_t c) {return {a.Self(), c};}
+template <class A> HistBinary<A, HistScalar, HistMul> operator*(const HistExpression<A>& a, Double_t c) {return {a.Self(), c};}
+template <class A> HistBinary<A, HistScalar, HistDiv> operator/(const HistExpression<A>& a, Double_t c) {return {a.Self(), c};}
+
+template <class B> HistBinary<HistScalar, B, HistAdd> operator+(Double_t c, const HistExpression<B>& b) {return {c, b.Self()};}
+template <class B> HistBinary<HistScalar, B, HistSub> operator-(Double_t c, const HistExpression<B>& b) {return {c, b.Self()};}
+template <class B> HistBinary<HistScalar, B, HistMul> operator*(Double_t c, const HistExpression<B>& b) {return {c, b.Self()};}
+template <class B> HistBinary<HistScalar, B, HistDiv> operator/(Double_t c, const HistExpression<B>& b) {return {c, b.Self()};}
+
+HistLeaf Expr(TH1* hist){
+
+  /** Wraps \p hist as operand of a histogram expression, e.g.
+      Evaluate((Expr(a) - Expr(b))/(Expr(c) + Expr(d)), "asymmetry").
+      Histograms that do not store Double_t are converted once here, all
+      others are read directly from their bin storage. Errors are taken from
+      Sumw2, or are Poisson errors if it is not set. Profiles store sums of
+      values instead of bin contents, their means and errors are converted. **/
+
+  HistLeaf leaf;
+  leaf.hist = hist;
+  if (!hist) return leaf;
+
+  hist->BufferEmpty();
+
+  Int_t nCells = hist->GetNcells();
+  Bool_t profile = hist->InheritsFrom("TProfile");
+  TArrayD* raw = profile ? nullptr : dynamic_cast<TArrayD*>(hist);
+
+  if (raw) leaf.contents = raw->GetArray();
+  else {
+    leaf.converted = std::make_shared<std::vector<Double_t>>(profile ? 2*nCells : nCells);
+    for (Int_t cell = 0; cell < nCells; cell++) (*leaf.converted)[cell] = hist->GetBinContent(cell);
+    leaf.contents = leaf.converted->data();
+  }
+
+  if (profile){
+    for (Int_t cell = 0; cell < nCells; cell++) (*leaf.converted)[nCells + cell] = std::pow(hist->GetBinError(cell), 2);
+    leaf.sumw2 = leaf.converted->data() + nCells;
+  }
+  else if (hist->GetSumw2N()) leaf.sumw2 = hist->GetSumw2()->GetArray();
+
+  return leaf;
+
+}
+
+template <class E>
+Bool_t EvaluateInto(TH1* output, const HistExpression<E>& expression){
+
+  /** Evaluates \p expression for all bins (including under- and overflow) of
+      \p output in a single pass, values and errors together, without any
+      intermediate histogram. Errors of the operands are treated as
+      uncorrelated and propagated to first order. \p output needs the binning
+      of all histograms in the expression and may be one of them, but not a
+      profile. Returns wether the expression could be evaluated. **/
+
+  std::vector<TH1*> hists;
+  expression.Self().Collect(hists);
+
+  Int_t nCells = output ? output->GetNcells() : 0;
+  Bool_t valid = output != nullptr;
+  for (TH1* hist : hists) valid = valid && hist && hist->GetNcells() == nCells;
+
+  if (!valid){
+    std::cout << "\033[1;31mERROR:\033[0m Histograms of the expression are missing or have different binnings! "
+              << "Expression will not be evaluated." << std::endl;
+    return kFALSE;
+  }
+
+  if (output->InheritsFrom("TProfile")){
+    std::cout << "\033[1;31mERROR:\033[0m Expression cannot be evaluated into profile " << output->GetName()
+              << "! Use a projection of it (TProfile::ProjectionX) instead." << std::endl;
+    return kFALSE;
+  }
+
+  if (!output->GetSumw2N()) output->Sumw2();
+  Double_t* sumw2 = output->GetSumw2()->GetArray();
+  const E& expr = expression.Self();
+
+  if (TArrayD* raw = dynamic_cast<TArrayD*>(output)){
+    Double_t* contents = raw->GetArray();
+    for (Int_t cell = 0; cell < nCells; cell++) expr.Evaluate(cell, contents[cell], sumw2[cell]);
+  }
+  else {
+    for (Int_t cell = 0; cell < nCells; cell++){
+      Double_t value;
+      expr.Evaluate(cell, value, sumw2[cell]);
+      output->SetBinContent(cell, value);
+    }
+  }
+
+  output->ResetStats();
+
+  return kTRUE;
+
+}
+
+template <class E>
+TH1* Evaluate(const HistExpression<E>& expression, TString name){
+
+  /** Returns a new histogram \p name (owned by the caller) of the type and
+      binning of the first histogram in \p expression, holding the expression
+      evaluated bin by bin (cf. EvaluateInto) **/
+
+  std::vector<TH1*> hists;
+  expression.Self().Collect(hists);
+
+  if (hists.empty() || !hists[0]){
+    std::cout << "\033[1;31mERROR:\033[0m Expression " << name << " contains no histogram!" << std::endl;
+    return nullptr;
+  }
+
+  TH1* output = (TH1*)hists[0]->Clone(name);
+  output->SetDirectory(nullptr);
+
+  if (EvaluateInto(output, expression)) return output;
+
+  delete output;
+  return nullptr;
+
+}
+
+//! Chain of preprocessing steps applied by PrepareHistograms, in the order of the members
+struct Preprocessing {
+  std::vector<Double_t> edges;   //!< Variable bin edges to rebin to (must coincide with existing edges), empty to keep the bins
+  Double_t norm {0};             //!< Integral to normalize to (e.g. 1 for unit area), 0 to keep the normalization
+  Bool_t   binWidth {kFALSE};    //!< Divide by the bin width
+};
+
+template <class T>
+Bool_t PrepareHistogramRaw(TH1* hist, T* content, const Preprocessing& steps){
+
+  /** Same as PrepareHistogram, but working directly on the bin storage
+      \p content of a one dimensional \p hist. Rebinning merges the bins in
+      place: every new bin only collects old bins at or behind its own
+      position, so the merged bins can be written over the old ones while
+      reading them. The integral is collected in the same pass, a second
+      pass over the merged bins applies normalization and bin widths. **/
+
+  Int_t nBins = hist->GetNbinsX();
+  TAxis* axis = hist->GetXaxis();
+  const std::vector<Double_t>& edges = steps.edges;
+  Bool_t rebin = !edges.empty();
+  Int_t nNew = rebin ? edges.size() - 1 : nBins;
+
+  if (rebin){
+    Bool_t aligned = edges.size() >= 2;
+    for (UInt_t edge = 0; edge < edges.size() && aligned; edge++){
+      Double_t position = edges[edge];
+      Int_t bin = std::min(std::max(axis->FindFixBin(position), 1), nBins);
+      Double_t tolerance = 1E-6*axis->GetBinWidth(bin);
+      aligned = (edge == 0 || position > edges[edge - 1])
+             && (TMath::Abs(axis->GetBinLowEdge(bin) - position) <= tolerance || TMath::Abs(axis->GetBinUpEdge(bin) - position) <= tolerance);
+    }
+    if (!aligned){
+      std::cout << "\033[1;31mERROR:\033[0m New bin edges do not coincide with the bins of " << hist->GetName() << "! Will be skipped." << std::endl;
+      return kFALSE;
+    }
+  }
+
+  Double_t entries = hist->GetEntries();
+  if (!hist->GetSumw2N() && (steps.norm || steps.binWidth)) hist->Sumw2();  // errors have to be scaled along
+  Double_t* sumw2 = hist->GetSumw2N() ? hist->GetSumw2()->GetArray() : nullptr;
+
+  Double_t integral = 0;
+
+  if (rebin){
+
+    Int_t current = 0;
+    Double_t sum = 0, sum2 = 0;
+
+    auto write = [&](Int_t target){
+      for (; current < target; current++){
+        content[current] = sum;
+        if (sumw2) sumw2[current] = sum2;
+        if (current >= 1 && current <= nNew) integral += sum;
+        sum = sum2 = 0;
+      }
+    };
+
+    for (Int_t bin = 0; bin <= nBins + 1; bin++){
+      Double_t center = axis->GetBinCenter(bin);
+      Int_t target = (bin == 0) ? 0 : (bin == nBins + 1) ? nNew + 1
+                   : std::upper_bound(edges.begin(), edges.end(), center) - edges.begin();
+      write(target);
+      sum += content[bin];
+      if (sumw2) sum2 += sumw2[bin];
+    }
+    write(nNew + 2);
+
+  }
+  else if (steps.norm){
+    for (Int_t bin = 1; bin <= nBins; bin++) integral += content[bin];
+  }
+
+  Double_t scale = (steps.norm && integral) ? steps.norm/integral : 1.;
+
+  if (scale != 1. || steps.binWidth){
+    for (Int_t bin = 0; bin <= nNew + 1; bin++){
+      Double_t factor = scale;
+      if (steps.binWidth && bin >= 1 && bin <= nNew) factor /= rebin ? edges[bin] - edges[bin - 1] : axis->GetBinWidth(bin);
+      content[bin] *= factor;
+      if (sumw2) sumw2[bin] *= factor*factor;
+    }
+  }
+
+  // shrinking the storage keeps the merged bins at its beginning
+  if (rebin) hist->SetBins(nNew, edges.data());
+
+  hist->ResetStats();
+  hist->SetEntries(entries);
+
+  return kTRUE;
+
+}
+
+Bool_t PrepareHistogram(TH1* hist, const Preprocessing& steps){
+
+  /** Applies \p steps to the one dimensional \p hist in place: rebinning to
+      the variable edges (bins outside of them go to under- and overflow),
+      normalization of the integral of the visible bins and division by the
+      bin width, with errors scaled along. Profiles are not supported, and
+      histograms with integer storage (TH1I, TH1S, TH1C) can only be rebinned,
+      as scaled contents would be truncated. Returns wether \p hist was changed. **/
+
+  if (!hist) return kFALSE;
+
+  hist->BufferEmpty();
+
+  if (hist->GetDimension() != 1){
+    std::cout << "\033[1;31mERROR:\033[0m " << hist->GetName() << " is not one dimensional and will not be prepared!" << std::endl;
+    return kFALSE;
+  }
+
+  // the storage of profiles holds sums of values, not bin contents
+  if (hist->InheritsFrom("TProfile")){
+    std::cout << "\033[1;31mERROR:\033[0m " << hist->GetName() << " is a profile and will not be prepared!" << std::endl;
+    return kFALSE;
+  }
+
+  if (TArrayD* raw = dynamic_cast<TArrayD*>(hist)) return PrepareHistogramRaw(hist, raw->GetArray(), steps);
+  if (TArrayF* raw = dynamic_cast<TArrayF*>(hist)) return PrepareHistogramRaw(hist, raw->GetArray(), steps);
+
+  if ((steps.norm || steps.binWidth) && (dynamic_cast<TArrayI*>(hist) || dynamic_cast<TArrayS*>(hist) || dynamic_cast<TArrayC*>(hist))){
+    std::cout << "\033[1;31mERROR:\033[0m " << hist->GetName() << " stores integers and can only be rebinned, "
+              << "use TH1F or TH1D for normalization or division by the bin width! Will be skipped." << std::endl;
+    return kFALSE;
+  }
+
+  if (TArrayI* raw = dynamic_cast<TArrayI*>(hist)) return PrepareHistogramRaw(hist, raw->GetArray(), steps);
+  if (TArrayS* raw = dynamic_cast<TArrayS*>(hist)) return PrepareHistogramRaw(hist, raw->GetArray(), steps);
+  if (TArrayC* raw = dynamic_cast<TArrayC*>(hist)) return PrepareHistogramRaw(hist, raw->GetArray(), steps);
+
+  std::cout << "\033[1;31mERROR:\033[0m Bin storage of " << hist->GetName() << " is unknown, it will not be prepared!" << std::endl;
+  return kFALSE;
+
+}
+
+Int_t PrepareHistograms(TObjArray* array, const Preprocessing& steps, Int_t nThreads = 0){
+
+  /** Batch version of PrepareHistogram for all histograms in \p array, spread
+      over \p nThreads threads (all hardware threads if 0), e.g.
+      PrepareHistograms(array, {{0, 1, 2, 5, 10}, 1., kTRUE}) for densities
+      with unit area in five bins. Entries that are no histograms (e.g.
+      legends) are skipped. Returns the number of prepared histograms. **/
+
+  if (!array){
+    std::cout << "\033[1;31mERROR:\033[0m array to be prepared does not exist!" << std::endl;
+    return 0;
+  }
+
+  Int_t nEntries = array->GetEntriesFast();
+  std::vector<TH1*> hists(nEntries, nullptr);
+  std::vector<Int_t> prepared(nEntries, 0);
+
+  for (Int_t entry = 0; entry < nEntries; entry++){
+    TObject* obj = array->At(entry);
+    if (obj && obj->InheritsFrom("TH1")) hists[entry] = (TH1*)obj;
+  }
+
+  ParallelFor(nEntries, [&](Int_t entry){
+    if (hists[entry]) prepared[entry] = PrepareHistogram(hists[entry], steps);
+  }, nThreads);
+
+  return std::accumulate(prepared.begin(), prepared.end(), 0);
+
 }